@@ -29,14 +29,48 @@ SEXP actuar_do_randomphtype2(int code, SEXP args, SEXPTYPE type);
 
 SEXP actuar_do_hierarc(SEXP args);
 SEXP actuar_do_panjer(SEXP args);
+SEXP actuar_do_panjerbatch(SEXP args);
+SEXP actuar_do_depril(SEXP args);
+SEXP actuar_do_rcompound(SEXP args);
+SEXP actuar_do_rcompoundpar(SEXP args);
+SEXP actuar_do_simcompound(SEXP args);
+SEXP actuar_do_prepare(SEXP args);
+SEXP actuar_do_dpqprep(SEXP args);
+SEXP actuar_do_loglik(SEXP args);
+SEXP actuar_do_fitloss(SEXP args);
+SEXP actuar_do_mde(SEXP args);
+SEXP actuar_do_ruinsa(SEXP args);
+
+/* Threaded evaluation in actuar_do_dpq() and actuar_do_dpqphtype() */
+#define ACTUAR_THREADS_MIN 10000
+int actuar_threads_option(int *minsize);
 
 /* Utility functions */
 /*   Matrix algebra */
 void actuar_expm(double *x, int n, double *z);
+int actuar_expm_work(double *x, int n, double *z, double *dwork, int *iwork, int *info);
 double actuar_expmprod(double *x, double *M, double *y, int n);
+double actuar_expmprod_work(double *x, double *M, double *y, int n, double *dwork, int *iwork);
+void actuar_expmv_work(double *x, double *M, int n, double *z, double *dwork);
+void actuar_expmv_op_work(double *x, double lambda, void (*vecmat)(double *, void *, int, double, double *), void *M, int n, double *z, double *dwork);
 void actuar_matpow(double *x, int n, int k, double *z);
 void actuar_solve(double *A, double *B, int n, int p, double *z);
 
+/*   Sizes of the workspaces of the *_work() functions above */
+#define EXPM_DWORK(n) (6 * (n) * (n) + 2 * (n))
+#define EXPM_IWORK(n) (2 * (n))
+#define EXPMPROD_DWORK(n) ((n) * (n) + (n) + EXPM_DWORK(n))
+#define EXPMV_DWORK(n) (2 * (n))
+
+/*   Largest parameter of the uniformization steps in
+ *   actuar_expmv_work(), and smallest order of the matrices for
+ *   which the action of the exponential is used instead of the full
+ *   matrix exponential when it needs fewer than EXPMV_TERMS * n
+ *   terms (the cost of the full exponential is about 25 n^3). */
+#define EXPMV_STEP 64.0
+#define EXPMV_MIN 32
+#define EXPMV_TERMS 16.0
+
 /*   Special integrals */
 double betaint(double x, double a, double b, int foo);
 double betaint_raw(double x, double a, double b);
@@ -51,25 +85,34 @@ double mgfexp(double t, double scale, int give_log);
 
 double dinvexp(double x, double scale, int give_log);
 double pinvexp(double q, double scale, int lower_tail, int log_p);
+void dinvexp_batch(const double *x, double *y, int n, const double *par, int give_log);
+void pinvexp_batch(const double *x, double *y, int n, const double *par, int lower_tail, int log_p);
 double qinvexp(double p, double scale, int lower_tail, int log_p);
 double rinvexp(double scale);
 double minvexp(double order, double scale, int give_log);
 double levinvexp(double limit, double scale, double order, int give_log);
+double dinvexp_grad(double x, const double *par, double *grad);
+double pinvexp_grad(double q, const double *par, double *grad);
 
 double dlogarithmic(double x, double p, int give_log);
 double plogarithmic(double x, double p, int lower_tail, int log_p);
 double qlogarithmic(double x, double p, int lower_tail, int log_p);
 double rlogarithmic(double p);
+double dlogarithmic_grad(double x, const double *par, double *grad);
 
 double dztpois(double x, double lambda, int give_log);
 double pztpois(double q, double lambda, int lower_tail, int log_p);
 double qztpois(double p, double lambda, int lower_tail, int log_p);
 double rztpois(double lambda);
+double dztpois_grad(double x, const double *par, double *grad);
+double pztpois_grad(double q, const double *par, double *grad);
 
 double dztgeom(double x, double prob, int give_log);
 double pztgeom(double q, double prob, int lower_tail, int log_p);
 double qztgeom(double p, double prob, int lower_tail, int log_p);
 double rztgeom(double prob);
+double dztgeom_grad(double x, const double *par, double *grad);
+double pztgeom_grad(double q, const double *par, double *grad);
 
 /*   Two parameter distributions */
 double munif(double order, double min, double max, int give_log);
@@ -85,6 +128,12 @@ double levbeta(double limit, double shape1, double shape2, double order, int giv
 double mgamma(double order, double shape, double scale, int give_log);
 double levgamma(double limit, double shape, double scale, double order, int give_log);
 double mgfgamma(double t, double shape, double scale, int give_log);
+int prepare_gamma(const double *par, double *c);
+double dgamma_prep(double x, const double *par, const double *c, int give_log);
+double pgamma_prep(double q, const double *par, const double *c, int lower_tail, int log_p);
+double qgamma_prep(double p, const double *par, const double *c, int lower_tail, int log_p);
+void prepare_levgamma(double order, const double *par, const double *c, double *co);
+double levgamma_prep(double limit, double order, const double *par, const double *c, const double *co);
 
 double mchisq(double order, double df, double ncp, int give_log);
 double levchisq(double limit, double df, double ncp, double order, int give_log);
@@ -97,27 +146,40 @@ double rinvgamma(double scale, double shape);
 double minvgamma(double order, double scale, double shape, int give_log);
 double levinvgamma(double limit, double scale, double shape, double order, int give_log);
 double mgfinvgamma(double t, double shape, double scale, int give_log);
+double dinvgamma_grad(double x, const double *par, double *grad);
 
 double dinvparalogis(double x, double shape, double scale, int give_log);
 double pinvparalogis(double q, double shape, double scale, int lower_tail, int log_p);
+void dinvparalogis_batch(const double *x, double *y, int n, const double *par, int give_log);
+void pinvparalogis_batch(const double *x, double *y, int n, const double *par, int lower_tail, int log_p);
 double qinvparalogis(double p, double shape, double scale, int lower_tail, int log_p);
 double rinvparalogis(double shape, double scale);
 double minvparalogis(double order, double shape, double scale, int give_log);
 double levinvparalogis(double limit, double shape, double scale, double order, int give_log);
+double dinvparalogis_grad(double x, const double *par, double *grad);
+double pinvparalogis_grad(double q, const double *par, double *grad);
 
 double dinvpareto(double x, double shape, double scale, int give_log);
 double pinvpareto(double q, double shape, double scale, int lower_tail, int log_p);
+void dinvpareto_batch(const double *x, double *y, int n, const double *par, int give_log);
+void pinvpareto_batch(const double *x, double *y, int n, const double *par, int lower_tail, int log_p);
 double qinvpareto(double p, double shape, double scale, int lower_tail, int log_p);
 double rinvpareto(double shape, double scale);
 double minvpareto(double order, double shape, double scale, int give_log);
 double levinvpareto(double limit, double shape, double scale, double order, int log_p);
+double dinvpareto_grad(double x, const double *par, double *grad);
+double pinvpareto_grad(double q, const double *par, double *grad);
 
 double dinvweibull(double x, double scale, double shape, int give_log);
 double pinvweibull(double q, double scale, double shape, int lower_tail, int log_p);
+void dinvweibull_batch(const double *x, double *y, int n, const double *par, int give_log);
+void pinvweibull_batch(const double *x, double *y, int n, const double *par, int lower_tail, int log_p);
 double qinvweibull(double p, double scale, double shape, int lower_tail, int log_p);
 double rinvweibull(double scale, double shape);
 double minvweibull(double order, double scale, double shape, int give_log);
 double levinvweibull(double limit, double scale, double shape, double order, int give_log);
+double dinvweibull_grad(double x, const double *par, double *grad);
+double pinvweibull_grad(double q, const double *par, double *grad);
 
 double dlgamma(double x, double shapelog, double ratelog, int give_log);
 double plgamma(double q, double shapelog, double ratelog, int lower_tail, int log_p);
@@ -128,34 +190,50 @@ double levlgamma(double limit, double shapelog, double ratelog, double order, in
 
 double dllogis(double x, double shape, double scale, int give_log);
 double pllogis(double q, double shape, double scale, int lower_tail, int log_p);
+void dllogis_batch(const double *x, double *y, int n, const double *par, int give_log);
+void pllogis_batch(const double *x, double *y, int n, const double *par, int lower_tail, int log_p);
 double qllogis(double p, double shape, double scale, int lower_tail, int log_p);
 double rllogis(double shape, double scale);
 double mllogis(double order, double shape, double scale, int give_log);
 double levllogis(double limit, double shape, double scale, double order, int give_log);
+double dllogis_grad(double x, const double *par, double *grad);
+double pllogis_grad(double q, const double *par, double *grad);
 
 double mlnorm(double order, double logmean, double logsd, int give_log);
 double levlnorm(double limit, double logmean, double logsd, double order, int give_log);
 
 double dparalogis(double x, double shape, double scale, int give_log);
 double pparalogis(double q, double shape, double scale, int lower_tail, int log_p);
+void dparalogis_batch(const double *x, double *y, int n, const double *par, int give_log);
+void pparalogis_batch(const double *x, double *y, int n, const double *par, int lower_tail, int log_p);
 double qparalogis(double p, double shape, double scale, int lower_tail, int log_p);
 double rparalogis(double shape, double scale);
 double mparalogis(double order, double shape, double scale, int give_log);
 double levparalogis(double limit, double shape, double scale, double order, int give_log);
+double dparalogis_grad(double x, const double *par, double *grad);
+double pparalogis_grad(double q, const double *par, double *grad);
 
 double dpareto(double x, double shape, double scale, int give_log);
 double ppareto(double q, double shape, double scale, int lower_tail, int log_p);
+void dpareto_batch(const double *x, double *y, int n, const double *par, int give_log);
+void ppareto_batch(const double *x, double *y, int n, const double *par, int lower_tail, int log_p);
 double qpareto(double p, double shape, double scale, int lower_tail, int log_p);
 double rpareto(double shape, double scale);
 double mpareto(double order, double shape, double scale, int give_log);
 double levpareto(double limit, double shape, double scale, double order, int give_log);
+double dpareto_grad(double x, const double *par, double *grad);
+double ppareto_grad(double q, const double *par, double *grad);
 
 double dpareto1(double x, double shape, double scale, int give_log);
 double ppareto1(double q, double shape, double scale, int lower_tail, int log_p);
+void dpareto1_batch(const double *x, double *y, int n, const double *par, int give_log);
+void ppareto1_batch(const double *x, double *y, int n, const double *par, int lower_tail, int log_p);
 double qpareto1(double p, double shape, double scale, int lower_tail, int log_p);
 double rpareto1(double shape, double scale);
 double mpareto1(double order, double shape, double scale, int give_log);
 double levpareto1(double limit, double shape, double scale, double order, int give_log);
+double dpareto1_grad(double x, const double *par, double *grad);
+double ppareto1_grad(double q, const double *par, double *grad);
 
 double mweibull(double order, double scale, double shape, int give_log);
 double levweibull(double limit, double scale, double shape, double order, int give_log);
@@ -179,45 +257,62 @@ double rinvgauss(double mu, double phi);
 double minvgauss(double order, double mean, double phi, int give_log);
 double levinvgauss(double limit, double mean, double phi, double order, int give_log);
 double mgfinvgauss(double t, double mean, double phi, int give_log);
+double dinvgauss_grad(double x, const double *par, double *grad);
 
 double dztnbinom(double x, double size, double prob, int give_log);
 double pztnbinom(double q, double size, double prob, int lower_tail, int log_p);
 double qztnbinom(double p, double size, double prob, int lower_tail, int log_p);
 double rztnbinom(double size, double prob);
+double dztnbinom_grad(double x, const double *par, double *grad);
 
 double dztbinom(double x, double size, double prob, int give_log);
 double pztbinom(double q, double size, double prob, int lower_tail, int log_p);
 double qztbinom(double p, double size, double prob, int lower_tail, int log_p);
 double rztbinom(double size, double prob);
+double dztbinom_grad(double x, const double *par, double *grad);
+double pztbinom_grad(double q, const double *par, double *grad);
 
 double dzmlogarithmic(double x, double p, double p0m, int give_log);
 double pzmlogarithmic(double x, double p, double p0m, int lower_tail, int log_p);
 double qzmlogarithmic(double x, double p, double p0m, int lower_tail, int log_p);
 double rzmlogarithmic(double p, double p0m);
+double dzmlogarithmic_grad(double x, const double *par, double *grad);
 
 double dzmpois(double x, double lambda, double p0m, int give_log);
 double pzmpois(double q, double lambda, double p0m, int lower_tail, int log_p);
 double qzmpois(double p, double lambda, double p0m, int lower_tail, int log_p);
 double rzmpois(double lambda, double p0m);
+double dzmpois_grad(double x, const double *par, double *grad);
+double pzmpois_grad(double q, const double *par, double *grad);
 
 double dzmgeom(double x, double prob, double p0m, int give_log);
 double pzmgeom(double q, double prob, double p0m, int lower_tail, int log_p);
 double qzmgeom(double p, double prob, double p0m, int lower_tail, int log_p);
 double rzmgeom(double prob, double p0m);
 double rzmgeom2(double prob, double p0m);
+double dzmgeom_grad(double x, const double *par, double *grad);
+double pzmgeom_grad(double q, const double *par, double *grad);
 
 double dpoisinvgauss(double x, double mu, double phi, int give_log);
 double ppoisinvgauss(double q, double mu, double phi, int lower_tail, int log_p);
 double qpoisinvgauss(double p, double mu, double phi, int lower_tail, int log_p);
 double rpoisinvgauss(double mu, double phi);
+int prepare_poisinvgauss(const double *par, double *c);
+double dpoisinvgauss_prep(double x, const double *par, const double *c, int give_log);
+double ppoisinvgauss_prep(double q, const double *par, const double *c, int lower_tail, int log_p);
+double qpoisinvgauss_prep(double p, const double *par, const double *c, int lower_tail, int log_p);
 
 /*   Three parameter distributions */
 double dburr(double x, double shape1, double shape2, double scale, int give_log);
 double pburr(double q, double shape1, double shape2, double scale, int lower_tail, int log_p);
+void dburr_batch(const double *x, double *y, int n, const double *par, int give_log);
+void pburr_batch(const double *x, double *y, int n, const double *par, int lower_tail, int log_p);
 double qburr(double p, double shape1, double shape2, double scale, int lower_tail, int log_p);
 double rburr(double shape1, double shape2, double scale);
 double mburr(double order, double shape1, double shape2, double scale, int give_log);
 double levburr(double limit, double shape1, double shape2, double scale, double order, int give_log);
+double dburr_grad(double x, const double *par, double *grad);
+double pburr_grad(double q, const double *par, double *grad);
 
 double dgenpareto(double x, double shape1, double shape2, double scale, int give_log);
 double pgenpareto(double q, double shape1, double shape2, double scale, int lower_tail, int log_p);
@@ -225,13 +320,18 @@ double qgenpareto(double p, double shape1, double shape2, double scale, int lowe
 double rgenpareto(double shape1, double shape2, double scale);
 double mgenpareto(double order, double shape1, double shape2, double scale, int give_log);
 double levgenpareto(double limit, double shape1, double shape2, double scale, double order, int give_log);
+double dgenpareto_grad(double x, const double *par, double *grad);
 
 double dinvburr(double x, double shape1, double shape2, double scale, int give_log);
 double pinvburr(double q, double shape1, double shape2, double scale, int lower_tail, int log_p);
+void dinvburr_batch(const double *x, double *y, int n, const double *par, int give_log);
+void pinvburr_batch(const double *x, double *y, int n, const double *par, int lower_tail, int log_p);
 double qinvburr(double p, double shape1, double shape2, double scale, int lower_tail, int log_p);
 double rinvburr(double shape1, double shape2, double scale);
 double minvburr(double order, double shape1, double shape2, double scale, int give_log);
 double levinvburr(double limit, double shape1, double shape2, double scale, double order, int give_log);
+double dinvburr_grad(double x, const double *par, double *grad);
+double pinvburr_grad(double q, const double *par, double *grad);
 
 double dinvtrgamma(double x, double shape1, double shape2, double scale, int give_log);
 double pinvtrgamma(double q, double shape1, double shape2, double scale, int lower_tail, int log_p);
@@ -239,6 +339,8 @@ double qinvtrgamma(double p, double shape1, double shape2, double scale, int low
 double rinvtrgamma(double shape1, double shape2, double scale);
 double minvtrgamma(double order, double shape1, double shape2, double scale, int give_log);
 double levinvtrgamma(double limit, double shape1, double shape2, double scale, double order, int give_log);
+void invtrgamma_dgrad_raw(double x, double shape1, double shape2, double scale, int psi, double *grad);
+double dinvtrgamma_grad(double x, const double *par, double *grad);
 
 double dtrgamma(double x, double shape1, double shape2, double scale, int give_log);
 double ptrgamma(double q, double shape1, double shape2, double scale, int lower_tail, int log_p);
@@ -246,16 +348,20 @@ double qtrgamma(double p, double shape1, double shape2, double scale, int lower_
 double rtrgamma(double shape1, double shape2, double scale);
 double mtrgamma(double order, double shape1, double shape2, double scale, int give_log);
 double levtrgamma(double limit, double shape1, double shape2, double scale, double order, int give_log);
+double dtrgamma_grad(double x, const double *par, double *grad);
 
 double dzmnbinom(double x, double size, double prob, double p0m, int give_log);
 double pzmnbinom(double q, double size, double prob, double p0m, int lower_tail, int log_p);
 double qzmnbinom(double p, double size, double prob, double p0m, int lower_tail, int log_p);
 double rzmnbinom(double size, double prob, double p0m);
+double dzmnbinom_grad(double x, const double *par, double *grad);
 
 double dzmbinom(double x, double size, double prob, double p0m, int give_log);
 double pzmbinom(double q, double size, double prob, double p0m, int lower_tail, int log_p);
 double qzmbinom(double p, double size, double prob, double p0m, int lower_tail, int log_p);
 double rzmbinom(double size, double prob, double p0m);
+double dzmbinom_grad(double x, const double *par, double *grad);
+double pzmbinom_grad(double q, const double *par, double *grad);
 
 /*   Four parameter distributions */
 double dgenbeta(double x, double shape1, double shape2, double shape3, double scale, int give_log);
@@ -271,10 +377,40 @@ double qtrbeta(double p, double shape1, double shape2, double shape3, double sca
 double rtrbeta(double shape1, double shape2, double shape3, double scale);
 double mtrbeta(double order, double shape1, double shape2, double shape3, double scale, int give_log);
 double levtrbeta(double limit, double shape1, double shape2, double shape3, double scale, double order, int give_log);
+int prepare_trbeta(const double *par, double *c);
+double dtrbeta_prep(double x, const double *par, const double *c, int give_log);
+double ptrbeta_prep(double q, const double *par, const double *c, int lower_tail, int log_p);
+double qtrbeta_prep(double p, const double *par, const double *c, int lower_tail, int log_p);
+void prepare_levtrbeta(double order, const double *par, const double *c, double *co);
+double levtrbeta_prep(double limit, double order, const double *par, const double *c, const double *co);
+void trbeta_dgrad_raw(double x, double shape1, double shape2, double shape3, double scale, int psi, double *grad);
+void trbeta_pgrad_raw(double x, double shape1, double shape2, double shape3, double scale, double *grad);
+double dtrbeta_grad(double x, const double *par, double *grad);
 
 /*   Phase-type distributions */
 double dphtype(double x, double *pi, double *T, int m, int give_log);
 double pphtype(double x, double *pi, double *T, int m, int lower_tail, int log_p);
+double dphtype_work(double x, double *pi, double *T, int m, int give_log, double *dwork, int *iwork);
+double pphtype_work(double x, double *pi, double *T, int m, int lower_tail, int log_p, double *dwork, int *iwork);
+#define PHTYPE_DWORK(m) ((m) * (m) + (m) + EXPMPROD_DWORK(m))
+#define PHTYPE_IWORK(m) EXPM_IWORK(m)
+void dphtype_grid(double *x, int *ord, int n, double *pi, double *T, int m, int give_log, double *y, double *dwork, int *iwork);
+void pphtype_grid(double *x, int *ord, int n, double *pi, double *T, int m, int lower_tail, int log_p, double *y, double *dwork, int *iwork);
+#define PHTYPE_GRID_DWORK(m) (2 * (m) * (m) + 3 * (m) + EXPM_DWORK(m))
+#define PHTYPE_GRID_RTOL (64 * DBL_EPSILON)
+#define PHTYPE_GRID_CHUNK 4096 /* points per restart of the stepping */
+typedef struct {
+    int m;
+    double *d, *s, *u, *v;      /* see phtype.c */
+    double scale;               /* multiplier of T in products */
+} phtype_bidiag_struct;
+void dphtype_bidiag_grid(double *x, int *ord, int n, double *pi, phtype_bidiag_struct *T, int give_log, double *y, double *dwork);
+void pphtype_bidiag_grid(double *x, int *ord, int n, double *pi, phtype_bidiag_struct *T, int lower_tail, int log_p, double *y, double *dwork);
+double dphtype_bidiag(double x, double *pi, phtype_bidiag_struct *T, int give_log, double *dwork);
+double pphtype_bidiag(double x, double *pi, phtype_bidiag_struct *T, int lower_tail, int log_p, double *dwork);
+double mphtype_bidiag(double order, double *pi, phtype_bidiag_struct *T, int give_log, double *dwork);
+double mgfphtype_bidiag(double x, double *pi, phtype_bidiag_struct *T, int give_log, double *dwork);
+#define PHTYPE_BIDIAG_DWORK(m) (5 * (m))
 double rphtype(double *pi, double **Q, double *rates, int m);
 double mphtype(double order, double *pi, double *T, int m, int give_log);
 double mgfphtype(double x, double *pi, double *T, int m, int give_log);
@@ -290,6 +426,7 @@ typedef struct {
     int code;
 } dpq_tab_struct;
 extern dpq_tab_struct dpq_tab[];
+int actuar_dpq_lookup(SEXP name);
 
 typedef struct {
     char *name;
@@ -298,3 +435,73 @@ typedef struct {
     SEXPTYPE type;
 } random_tab_struct;
 extern random_tab_struct random_tab[];
+
+/* Table of the distributions known to the compound models simulation
+ * routines, with the number of parameters of the r* function, the
+ * matching q* function and the type of the variates (INTSXP for
+ * discrete distributions). */
+typedef struct {
+    char *name;
+    int npar;
+    double (*fun)();
+    double (*qfun)();
+    SEXPTYPE type;
+} compound_tab_struct;
+extern compound_tab_struct compound_tab[];
+
+/* Table of the distributions known to the log-likelihood routines
+ * and to the minimum distance objectives, with the number of
+ * parameters, their domain, the matching d* and p* functions, the
+ * functions computing the gradients of the log-density and of the
+ * log of the survival function and the lev* function (0 when not
+ * available). The domain of each parameter is coded by a letter:
+ * 'p' for positive, 'u' for the unit interval, 'r' for the real line
+ * and 'f' for a parameter always held fixed in estimation. */
+#define LOGLIK_MAXPAR 4
+typedef struct {
+    char *name;
+    int npar;
+    char *domain;
+    double (*dfun)();
+    double (*pfun)();
+    double (*dgrad)(double, const double *, double *);
+    double (*pgrad)(double, const double *, double *);
+    double (*levfun)();
+} loglik_tab_struct;
+extern loglik_tab_struct loglik_tab[];
+
+/* Data for the log-likelihood routines: individual observations with
+ * weights, censoring indicators and truncation points (of length 1
+ * or n), or grouped data with n + 1 group boundaries in 'x' and the
+ * frequencies in 'w'. */
+typedef struct {
+    loglik_tab_struct *d;
+    int n;
+    int grouped;
+    double *x;
+    double *w;
+    int *cens;
+    double *trunc;
+    int ntrunc;
+} loglik_data_struct;
+loglik_tab_struct *actuar_loglik_lookup(SEXP name);
+int actuar_loglik_data(SEXP args, loglik_data_struct *data);
+double actuar_loglik(loglik_data_struct *data, double *par, double *grad);
+
+/* Table of the prepared distributions, with the number of parameters
+ * and of constants depending on the parameters only, the function
+ * computing these constants and the functions using them. */
+#define PREPARED_MAXCONST 8
+
+typedef struct {
+    char *name;
+    int npar;
+    int nconst;
+    int (*prepare)(const double *, double *);
+    double (*d)(double, const double *, const double *, int);
+    double (*p)(double, const double *, const double *, int, int);
+    double (*q)(double, const double *, const double *, int, int);
+    void (*prepare_lev)(double, const double *, const double *, double *);
+    double (*lev)(double, double, const double *, const double *, const double *);
+} prepared_tab_struct;
+extern prepared_tab_struct prepared_tab[];
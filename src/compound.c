@@ -0,0 +1,550 @@
+/*  ===== actuar: An R Package for Actuarial Science =====
+ *
+ *  Simulation of standard, non hierarchical, compound models S = X_1
+ *  + ... + X_N where the distributions of N and of the X_j are found
+ *  in table compound_tab of names.c and have scalar parameters. The
+ *  claim amounts are drawn and summed on the fly: no vector of
+ *  individual claim amounts is ever created.
+ *
+ *  Function actuar_do_rcompound() returns a sample of S; the only
+ *  memory used is that of the result, where the frequencies are
+ *  stored until the claim amounts are drawn. Function
+ *  actuar_do_simcompound() returns the empirical distribution of a
+ *  sample of S in the form of the sorted distinct values and their
+ *  relative frequencies. When the severity distribution is
+ *  discrete, the sample is tabulated as it is generated and its
+ *  memory footprint is that of the table only.
+ *
+ *  Function actuar_do_rcompoundpar() returns a sample of S simulated
+ *  in parallel (with OpenMP, when available) by inversion of the
+ *  quantile functions. The uniform numbers come from the counter
+ *  based generator Philox4x32-10 (Salmon et al., 2011) keyed with
+ *  two draws of the R generator. The i-th aggregate always consumes
+ *  the stream of counters (k, 0, i, 0), k = 0, 1, ..., so the
+ *  sample is the same for a given seed whatever the number of
+ *  threads and the scheduling of the iterations. The quantile
+ *  functions of R may issue warnings through the R API, which must
+ *  not be called from the threads: the frequencies are hence
+ *  computed on the main thread, and only the severity distributions
+ *  with a quantile function in closed form are simulated in the
+ *  threads.
+ *
+ *  AUTHOR: Vincent Goulet <vincent.goulet@act.ulaval.ca>
+ */
+
+#include <stdint.h>
+#include <R.h>
+#include <Rmath.h>
+#include <Rinternals.h>
+#include "actuar.h"
+#include "locale.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#ifdef HAVE_LONG_DOUBLE
+# define LDOUBLE long double
+#else
+# define LDOUBLE double
+#endif
+
+#define CAD5R(e) CAR(CDR(CDR(CDR(CDR(CDR(e))))))
+#define CAD6R(e) CAR(CDR(CDR(CDR(CDR(CDR(CDR(e)))))))
+
+#define INITSIZE 100		/* default size of the table of counts */
+#define MAXCOUNTS 16777216	/* maximum size of the table of counts */
+#define CHECKINT 4096		/* variates between checks for interrupts */
+
+/* Look up a distribution in the table and check the number of
+ * parameters. */
+static compound_tab_struct *compound_lookup(SEXP name, SEXP par)
+{
+    int i;
+    const char *s = CHAR(STRING_ELT(name, 0));
+
+    for (i = 0; compound_tab[i].name; i++)
+    {
+	if (!strcmp(compound_tab[i].name, s))
+	{
+	    if (LENGTH(par) != compound_tab[i].npar)
+		error(_("invalid arguments"));
+	    return &compound_tab[i];
+	}
+    }
+
+    /* No match is an error */
+    error(_("internal error in actuar_do_rcompound"));
+
+    return NULL;		/* never used; to keep -Wall happy */
+}
+
+/* One variate from distribution 'd' with parameters 'p'. */
+static double compound_draw(compound_tab_struct *d, double *p)
+{
+    switch (d->npar)
+    {
+    case 1:
+	return d->fun(p[0]);
+    case 2:
+	return d->fun(p[0], p[1]);
+    case 3:
+	return d->fun(p[0], p[1], p[2]);
+    default:
+	return d->fun(p[0], p[1], p[2], p[3]);
+    }
+}
+
+/* Check for user interrupts every CHECKINT calls, the number of
+ * calls since the last check being kept in 'count'. */
+static void compound_checkint(int *count)
+{
+    if (++*count == CHECKINT)
+    {
+	R_CheckUserInterrupt();
+	*count = 0;
+    }
+}
+
+/* Sum of 'N' claim amounts, accumulated in extended precision as
+ * with sum() in R. Each variate drawn counts towards the next check
+ * for user interrupts. */
+static double compound_sum(compound_tab_struct *sev, double *ps,
+			   double N, int *count)
+{
+    double j;
+    LDOUBLE s = 0.0;
+
+    for (j = 0; j < N; j++)
+    {
+	s += compound_draw(sev, ps);
+	compound_checkint(count);
+    }
+
+    return (double) s;
+}
+
+/* One variate of the aggregate claim amount. */
+static double compound_draw_S(compound_tab_struct *freq, double *pf,
+			      compound_tab_struct *sev, double *ps,
+			      int *count)
+{
+    double N;
+
+    N = compound_draw(freq, pf);
+    compound_checkint(count);
+    if (ISNAN(N) || N < 0)
+	return NA_REAL;
+
+    return compound_sum(sev, ps, N, count);
+}
+
+/* Philox4x32-10 counter based generator: the block of four 32 bit
+ * words for counter 'ctr' and key 'key'. */
+#define PHILOX_M0 0xD2511F53U
+#define PHILOX_M1 0xCD9E8D57U
+#define PHILOX_W0 0x9E3779B9U
+#define PHILOX_W1 0xBB67AE85U
+
+static void philox4x32(const uint32_t *ctr, const uint32_t *key,
+		       uint32_t *out)
+{
+    int r;
+    uint32_t x0 = ctr[0], x1 = ctr[1], x2 = ctr[2], x3 = ctr[3];
+    uint32_t k0 = key[0], k1 = key[1];
+    uint64_t p0, p1;
+
+    for (r = 0; r < 10; r++)
+    {
+	if (r > 0)
+	{
+	    k0 += PHILOX_W0;
+	    k1 += PHILOX_W1;
+	}
+	p0 = (uint64_t) PHILOX_M0 * x0;
+	p1 = (uint64_t) PHILOX_M1 * x2;
+	x0 = (uint32_t) (p1 >> 32) ^ x1 ^ k0;
+	x1 = (uint32_t) p1;
+	x2 = (uint32_t) (p0 >> 32) ^ x3 ^ k1;
+	x3 = (uint32_t) p0;
+    }
+    out[0] = x0; out[1] = x1; out[2] = x2; out[3] = x3;
+}
+
+/* Stream of uniform numbers of one aggregate claim amount. Each block
+ * of the generator yields two numbers in (0, 1) with 53 bits. */
+typedef struct {
+    uint32_t ctr[4];
+    const uint32_t *key;
+    double u[2];
+    int left;
+} philox_stream;
+
+/* The index of the aggregate is an int, so the last word of the
+ * counter is unused. */
+static void stream_init(philox_stream *st, const uint32_t *key, int i)
+{
+    st->ctr[0] = 0;
+    st->ctr[1] = 0;
+    st->ctr[2] = (uint32_t) i;
+    st->ctr[3] = 0;
+    st->key = key;
+    st->left = 0;
+}
+
+static double stream_unif(philox_stream *st)
+{
+    uint32_t b[4];
+
+    if (st->left == 0)
+    {
+	philox4x32(st->ctr, st->key, b);
+	if (++st->ctr[0] == 0) st->ctr[1]++;
+	st->u[0] = ((b[0] >> 5) * 67108864.0 + (b[1] >> 6) + 0.5) / 9007199254740992.0;
+	st->u[1] = ((b[2] >> 5) * 67108864.0 + (b[3] >> 6) + 0.5) / 9007199254740992.0;
+	st->left = 2;
+    }
+    return st->u[2 - st->left--];
+}
+
+/* Quantile of order 'u' of distribution 'd' with parameters 'p'. */
+static double compound_quantile(compound_tab_struct *d, double *p, double u)
+{
+    switch (d->npar)
+    {
+    case 1:
+	return d->qfun(u, p[0], 1, 0);
+    case 2:
+	return d->qfun(u, p[0], p[1], 1, 0);
+    case 3:
+	return d->qfun(u, p[0], p[1], p[2], 1, 0);
+    default:
+	return d->qfun(u, p[0], p[1], p[2], p[3], 1, 0);
+    }
+}
+
+/* Check for user interrupts from a parallel region. Only the master
+ * thread may call the R API; R_ToplevelExec() returns FALSE on an
+ * interrupt instead of jumping out of the region, and the other
+ * threads learn of it through 'stop'. */
+static void compound_chkint(void *dummy)
+{
+    R_CheckUserInterrupt();
+}
+
+static void compound_pollint(volatile int *stop)
+{
+#ifdef _OPENMP
+    if (omp_get_thread_num() != 0)
+	return;
+#endif
+    if (!R_ToplevelExec(compound_chkint, NULL))
+	*stop = 1;
+}
+
+/* Sum of 'N' severities by inversion, using the stream of uniform
+ * numbers 'st'. */
+static double compound_qsum(compound_tab_struct *sev, double *ps,
+			    double N, philox_stream *st, volatile int *stop)
+{
+    int count = 0;
+    double j, s = 0.0;
+
+    for (j = 0; j < N && !*stop; j++)
+    {
+	s += compound_quantile(sev, ps, stream_unif(st));
+	if (++count == CHECKINT)
+	{
+	    compound_pollint(stop);
+	    count = 0;
+	}
+    }
+
+    return s;
+}
+
+/* Distributions with a quantile function in closed form that never
+ * calls the R API, hence safe to use in the threads. */
+static Rboolean compound_threadsafe(const char *name)
+{
+    int i;
+    const char *parallel[] = {"rexp", "rweibull", "runif", "rinvexp",
+			      "rinvparalogis", "rinvpareto", "rinvweibull",
+			      "rllogis", "rparalogis", "rpareto", "rpareto1",
+			      "rgumbel", "rburr", "rinvburr", NULL};
+
+    for (i = 0; parallel[i]; i++)
+	if (!strcmp(parallel[i], name))
+	    return TRUE;
+
+    return FALSE;
+}
+
+/*  Arguments of actuar_do_rcompound() and actuar_do_simcompound()
+ *  are:
+ *
+ *      1. the number of simulations;
+ *      2. the name of the frequency distribution (e.g. "rpois");
+ *      3. the vector of its parameters;
+ *      4. the name of the severity distribution;
+ *      5. the vector of its parameters.
+ *
+ *  Function actuar_do_rcompoundpar() has a sixth argument: the
+ *  number of threads.
+ *
+ *  The value of actuar_do_rcompound() is the vector of variates. */
+SEXP actuar_do_rcompound(SEXP args)
+{
+    SEXP sfreq, ssev, x;
+    compound_tab_struct *freq, *sev;
+    double *pf, *ps, *rx;
+    int i, n, count = 0;
+    Rboolean naflag = FALSE;
+
+    n = asInteger(CADR(args));
+    if (n == NA_INTEGER || n < 0)
+	error(_("invalid arguments"));
+    PROTECT(sfreq = coerceVector(CADDDR(args), REALSXP));
+    PROTECT(ssev = coerceVector(CAD5R(args), REALSXP));
+    freq = compound_lookup(CADDR(args), sfreq);
+    sev = compound_lookup(CAD4R(args), ssev);
+    pf = REAL(sfreq);
+    ps = REAL(ssev);
+
+    PROTECT(x = allocVector(REALSXP, n));
+    rx = REAL(x);
+
+    /* All the frequencies are drawn first, then the claim amounts in
+     * sequence, as in the simulation in R: the sample for a given
+     * seed is the same as with SIMPLIFY = FALSE. */
+    GetRNGstate();
+    for (i = 0; i < n; i++)
+    {
+	rx[i] = compound_draw(freq, pf);
+	compound_checkint(&count);
+    }
+    for (i = 0; i < n; i++)
+    {
+	if (ISNAN(rx[i]) || rx[i] < 0)
+	{
+	    rx[i] = NA_REAL;
+	    naflag = TRUE;
+	    continue;
+	}
+	rx[i] = compound_sum(sev, ps, rx[i], &count);
+    }
+    PutRNGstate();
+
+    if (naflag)
+	warning(R_MSG_NA);
+
+    UNPROTECT(3);
+    return x;
+}
+
+/*  The value of actuar_do_rcompoundpar() is the vector of variates,
+ *  or NULL when the frequency distribution has no quantile function
+ *  in the table or the severity distribution is not safe to simulate
+ *  in the threads (the caller then uses the serial simulation). */
+SEXP actuar_do_rcompoundpar(SEXP args)
+{
+    SEXP sfreq, ssev, x;
+    compound_tab_struct *freq, *sev;
+    double *pf, *ps, *rx;
+    uint32_t key[2];
+    int i, n, nthreads, count = 0;
+    volatile int stop = 0;
+    Rboolean naflag = FALSE;
+
+    n = asInteger(CADR(args));
+    nthreads = asInteger(CAD6R(args));
+    if (n == NA_INTEGER || n < 0 || nthreads == NA_INTEGER || nthreads < 1)
+	error(_("invalid arguments"));
+    PROTECT(sfreq = coerceVector(CADDDR(args), REALSXP));
+    PROTECT(ssev = coerceVector(CAD5R(args), REALSXP));
+    freq = compound_lookup(CADDR(args), sfreq);
+    sev = compound_lookup(CAD4R(args), ssev);
+    pf = REAL(sfreq);
+    ps = REAL(ssev);
+
+    if (freq->qfun == NULL || !compound_threadsafe(sev->name))
+    {
+	UNPROTECT(2);
+	return R_NilValue;
+    }
+
+    PROTECT(x = allocVector(REALSXP, n));
+    rx = REAL(x);
+
+    /* Invalid parameters make the whole sample missing. */
+    if (ISNAN(compound_quantile(freq, pf, 0.5)) ||
+	ISNAN(compound_quantile(sev, ps, 0.5)))
+    {
+	for (i = 0; i < n; i++)
+	    rx[i] = NA_REAL;
+	if (n > 0)
+	    warning(R_MSG_NA);
+	UNPROTECT(3);
+	return x;
+    }
+
+    /* The key of the generator depends on the seed of R. */
+    GetRNGstate();
+    key[0] = (uint32_t) (unif_rand() * 4294967296.0);
+    key[1] = (uint32_t) (unif_rand() * 4294967296.0);
+    PutRNGstate();
+
+    /* Frequencies on the main thread, from the first number of each
+     * stream. */
+    for (i = 0; i < n; i++)
+    {
+	philox_stream st;
+	stream_init(&st, key, i);
+	rx[i] = compound_quantile(freq, pf, stream_unif(&st));
+	compound_checkint(&count);
+    }
+
+    /* Severities in the threads, from the rest of the streams. */
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(nthreads) schedule(dynamic, 256)
+#endif
+    for (i = 0; i < n; i++)
+    {
+	philox_stream st;
+	if (ISNAN(rx[i]) || rx[i] < 0)
+	{
+	    rx[i] = NA_REAL;
+	    continue;
+	}
+	stream_init(&st, key, i);
+	stream_unif(&st);	/* frequency */
+	rx[i] = compound_qsum(sev, ps, rx[i], &st, &stop);
+    }
+    if (stop)
+	error(_("simulation interrupted"));
+
+    for (i = 0; i < n; i++)
+	if (ISNAN(rx[i]))
+	{
+	    naflag = TRUE;
+	    break;
+	}
+    if (naflag)
+	warning(R_MSG_NA);
+
+    UNPROTECT(3);
+    return x;
+}
+
+/*  The value of actuar_do_simcompound() is a list of two vectors:
+ *  the sorted distinct values of the sample and their relative
+ *  frequencies. Missing values are dropped, with a warning. */
+SEXP actuar_do_simcompound(SEXP args)
+{
+    SEXP sfreq, ssev, res, vals, probs;
+    compound_tab_struct *freq, *sev;
+    double *pf, *ps, *x = NULL, s;
+    int *counts = NULL;
+    int i, k, n, nx = 0, nna = 0, nvals = 0, size = INITSIZE, count = 0;
+
+    n = asInteger(CADR(args));
+    if (n == NA_INTEGER || n < 0)
+	error(_("invalid arguments"));
+    PROTECT(sfreq = coerceVector(CADDDR(args), REALSXP));
+    PROTECT(ssev = coerceVector(CAD5R(args), REALSXP));
+    freq = compound_lookup(CADDR(args), sfreq);
+    sev = compound_lookup(CAD4R(args), ssev);
+    pf = REAL(sfreq);
+    ps = REAL(ssev);
+
+    /* Discrete aggregate claim amounts are tabulated directly, at
+     * least as long as they fit in a table of reasonable size.
+     * Otherwise, all values are stored in 'x' for sorting. */
+    if (sev->type == INTSXP)
+	counts = (int *) S_alloc(size, sizeof(int));
+    else
+	x = (double *) R_alloc(n, sizeof(double));
+
+    GetRNGstate();
+    for (i = 0; i < n; i++)
+    {
+	s = compound_draw_S(freq, pf, sev, ps, &count);
+
+	if (ISNAN(s))
+	{
+	    nna++;
+	    continue;
+	}
+
+	if (counts)
+	{
+	    if (s < MAXCOUNTS)
+	    {
+		if (s >= size)
+		{
+		    k = size;
+		    while (s >= size)
+			size <<= 1;
+		    counts = (int *) S_realloc((char *) counts, size, k, sizeof(int));
+		}
+		counts[(int) s]++;
+		continue;
+	    }
+
+	    /* Value too large for the table: switch to storage of the
+	     * values, starting with those already tabulated. */
+	    x = (double *) R_alloc(n, sizeof(double));
+	    for (k = 0; k < size; k++)
+		while (counts[k]--)
+		    x[nx++] = k;
+	    counts = NULL;
+	}
+
+	x[nx++] = s;
+    }
+    PutRNGstate();
+
+    if (nna)
+	warning(_("NAs produced"));
+
+    /* Distinct values and their relative frequencies. */
+    if (counts)
+    {
+	for (k = 0; k < size; k++)
+	    if (counts[k]) nvals++;
+	PROTECT(vals = allocVector(REALSXP, nvals));
+	PROTECT(probs = allocVector(REALSXP, nvals));
+	for (i = 0, k = 0; k < size; k++)
+	    if (counts[k])
+	    {
+		REAL(vals)[i] = k;
+		REAL(probs)[i++] = (double) counts[k] / (n - nna);
+	    }
+    }
+    else
+    {
+	R_rsort(x, nx);
+	for (i = 0; i < nx; i++)
+	    if (i == 0 || x[i] != x[i - 1]) nvals++;
+	PROTECT(vals = allocVector(REALSXP, nvals));
+	PROTECT(probs = allocVector(REALSXP, nvals));
+	for (i = 0, k = -1; i < nx; i++)
+	{
+	    if (i == 0 || x[i] != x[i - 1])
+	    {
+		REAL(vals)[++k] = x[i];
+		REAL(probs)[k] = 0.0;
+	    }
+	    REAL(probs)[k]++;
+	}
+	for (k = 0; k < nvals; k++)
+	    REAL(probs)[k] /= nx;
+    }
+
+    PROTECT(res = allocVector(VECSXP, 2));
+    SET_VECTOR_ELT(res, 0, vals);
+    SET_VECTOR_ELT(res, 1, probs);
+
+    UNPROTECT(5);
+    return res;
+}
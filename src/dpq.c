@@ -20,6 +20,7 @@
  *  Function actuar_do_dpq() will extract the name of the distribution, look
  *  up in table dpq_tab defined in names.c which of actuar_do_dpq{1,2,3,4}
  *  should take care of the calculation and dispatch to this function.
+ *  The look up is done once per name; see actuar_dpq_lookup() below.
  *  In turn, functions actuar_do_dpq{1,2,3,4} call function
  *  {d,p,q,m,lev,mgf}dist() to get actual values from distribution
  *  "dist".
@@ -45,8 +46,12 @@
 
 #include <R.h>
 #include <Rinternals.h>
+#include <stdint.h>
 #include "actuar.h"
 #include "locale.h"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 /* Additional access macros */
 #define CAD5R(e) CAR(CDR(CDR(CDR(CDR(CDR(e))))))
@@ -54,6 +59,186 @@
 #define CAD7R(e) CAR(CDR(CDR(CDR(CDR(CDR(CDR(CDR(e))))))))
 
 
+/* Threaded evaluation, on request only. The number of threads is
+ * given by option "actuar.threads" (default 1, that is serial
+ * evaluation) and threads are used only when the result has at
+ * least "actuar.threads.min" elements (default 10000). The options
+ * are read by actuar_threads_option() in the main thread, at each
+ * call to actuar_do_dpq() for the functions that may use threads,
+ * and at each call to actuar_do_dpqphtype().
+ *
+ * Only the density and distribution functions in closed form are
+ * evaluated in threads; see dpq_threadsafe(). */
+static int dpq_nthreads = 1, dpq_minsize = ACTUAR_THREADS_MIN;
+
+static int dpq_threads(int n)
+{
+    return (n >= dpq_minsize) ? dpq_nthreads : 1;
+}
+
+/* Loop directive for the threaded shape of the ITERATE_DPQ* macros
+ * below; 'naflag' is combined over the threads. */
+#ifdef _OPENMP
+#define DPQ_PRAGMA(x) _Pragma(#x)
+#define DPQ_OMP_FOR(...)                                        \
+    DPQ_PRAGMA(omp parallel for num_threads(dpq_threads(n))     \
+               private(__VA_ARGS__) reduction(||:naflag))
+#else
+#define DPQ_OMP_FOR(...)
+#endif
+
+int actuar_threads_option(int *minsize)
+{
+    int nthreads = 1;
+#ifdef _OPENMP
+    SEXP opt;
+    static SEXP threads_sym = NULL, threads_min_sym = NULL;
+
+    if (threads_sym == NULL)
+    {
+        threads_sym = install("actuar.threads");
+        threads_min_sym = install("actuar.threads.min");
+    }
+#endif
+
+    *minsize = ACTUAR_THREADS_MIN;
+#ifdef _OPENMP
+    opt = GetOption1(threads_sym);
+    if (!isNull(opt))
+    {
+        nthreads = asInteger(opt);
+        if (nthreads == NA_INTEGER || nthreads < 1)
+            nthreads = 1;
+        else if (nthreads > omp_get_num_procs())
+            nthreads = omp_get_num_procs();
+    }
+    if (nthreads == 1)          /* serial evaluation: no need for more */
+        return nthreads;
+    opt = GetOption1(threads_min_sym);
+    if (!isNull(opt))
+    {
+        *minsize = asInteger(opt);
+        if (*minsize == NA_INTEGER || *minsize < 1)
+            *minsize = ACTUAR_THREADS_MIN;
+    }
+#endif
+
+    return nthreads;
+}
+
+/* Functions evaluated in threads: the density and distribution
+ * functions in closed form, that is those with a batch kernel. The
+ * other functions rely on the special functions of R (pbeta(),
+ * pgamma(), gammafn(), ...) that may issue warnings through the R
+ * API --- a jump out of the threads under options(warn = 2) --- or
+ * call the R API themselves; they are always evaluated serially. */
+static Rboolean dpq_threadsafe(const char *name)
+{
+    int i;
+    const char *parallel[] = {"dinvexp", "pinvexp",
+                              "dinvparalogis", "pinvparalogis",
+                              "dinvpareto", "pinvpareto",
+                              "dinvweibull", "pinvweibull",
+                              "dllogis", "pllogis",
+                              "dparalogis", "pparalogis",
+                              "dpareto", "ppareto",
+                              "dpareto1", "ppareto1",
+                              "dburr", "pburr",
+                              "dinvburr", "pinvburr", NULL};
+
+    for (i = 0; parallel[i]; i++)
+        if (!strcmp(parallel[i], name))
+            return TRUE;
+
+    return FALSE;
+}
+
+
+/* Batch evaluation for the distributions with a batch kernel in
+ * their d or p function, used when all the parameters are of length
+ * one (the usual case). The kernel validates the parameters and
+ * computes the constants depending on them once, then fills the
+ * result for the whole vector 'x' without recycling of the
+ * parameters. Missing values in 'x' are set here as in the loops
+ * below. */
+static Rboolean dpq_batch_ok(SEXP args, int npar)
+{
+    int i;
+    SEXP s = args;
+
+    if (!isNumeric(CAR(s)) || LENGTH(CAR(s)) == 0)
+        return FALSE;
+    for (i = 0, s = CDR(s); i < npar; i++, s = CDR(s))
+        if (!isNumeric(CAR(s)) || LENGTH(CAR(s)) != 1 || ISNAN(asReal(CAR(s))))
+            return FALSE;
+
+    return TRUE;
+}
+
+static SEXP dpq_batch(SEXP args, int npar, int nflags, void (*fb)())
+{
+    SEXP sx, sy, s;
+    int i, n, i_1, i_2 = 0, sxo;
+    double par[3], *x, *y;
+    Rboolean naflag = FALSE;
+
+    sx = CAR(args);
+    sxo = OBJECT(sx);
+    for (i = 0, s = CDR(args); i < npar; i++, s = CDR(s))
+        par[i] = asReal(CAR(s));
+    i_1 = asInteger(CAR(s));
+    if (nflags > 1)
+        i_2 = asInteger(CADR(s));
+
+    n = LENGTH(sx);
+    PROTECT(sx = coerceVector(sx, REALSXP));
+    PROTECT(sy = allocVector(REALSXP, n));
+    x = REAL(sx);
+    y = REAL(sy);
+
+#ifdef _OPENMP
+    /* The kernels work on contiguous data: split the vector 'x' in
+     * one block per thread. */
+    int nth = dpq_threads(n);
+    if (nth > 1)
+    {
+        int k;
+#pragma omp parallel for num_threads(nth)
+        for (k = 0; k < nth; k++)
+        {
+            int lo = (int) ((double) n * k / nth),
+                hi = (int) ((double) n * (k + 1) / nth);
+            if (nflags > 1)
+                fb(x + lo, y + lo, hi - lo, par, i_1, i_2);
+            else
+                fb(x + lo, y + lo, hi - lo, par, i_1);
+        }
+    }
+    else
+#endif
+    if (nflags > 1)
+        fb(x, y, n, par, i_1, i_2);
+    else
+        fb(x, y, n, par, i_1);
+
+    for (i = 0; i < n; i++)
+    {
+        if      (ISNA (x[i])) y[i] = NA_REAL;
+        else if (ISNAN(x[i])) y[i] = R_NaN;
+        else if (ISNAN(y[i])) naflag = TRUE;
+    }
+
+    if (naflag)
+        warning(R_MSG_NA);
+
+    SET_ATTRIB(sy, duplicate(ATTRIB(sx)));
+    SET_OBJECT(sy, sxo);
+    UNPROTECT(2);
+
+    return sy;
+}
+
+
 /* Functions for one parameter distributions */
 #define if_NA_dpq1_set(y, x, a)                         \
         if      (ISNA (x) || ISNA (a)) y = NA_REAL;     \
@@ -65,6 +250,42 @@
              i2 = (++i2 == n2) ? 0 : i2,        \
              ++i)
 
+/* Evaluation of f() for every element of the result, CALL being the
+ * call to f(). The shape of the loop is chosen once per call: the
+ * threaded loop (see dpq_threads() above); plain stride-1 loops when
+ * all the parameters are of length one, or when all the arguments
+ * have the same length; recycling of the arguments with
+ * mod_iterate1() otherwise. Same for the other numbers of
+ * parameters below. */
+#define DPQ1_ELEMENT(X, A, CALL)                                \
+    {                                                           \
+        xi = X;                                                 \
+        ai = A;                                                 \
+        if_NA_dpq1_set(y[i], xi, ai)                            \
+        else                                                    \
+        {                                                       \
+            y[i] = CALL;                                        \
+            if (ISNAN(y[i])) naflag = TRUE;                     \
+        }                                                       \
+    }
+
+#define ITERATE_DPQ1(CALL)                                      \
+    if (dpq_threads(n) > 1)                                     \
+    {                                                           \
+        DPQ_OMP_FOR(xi, ai)                                     \
+        for (i = 0; i < n; i++)                                 \
+            DPQ1_ELEMENT(x[i % nx], a[i % na], CALL)            \
+    }                                                           \
+    else if (na == 1)                                           \
+        for (i = 0; i < n; i++)                                 \
+            DPQ1_ELEMENT(x[i], a[0], CALL)                      \
+    else if (nx == n && na == n)                                \
+        for (i = 0; i < n; i++)                                 \
+            DPQ1_ELEMENT(x[i], a[i], CALL)                      \
+    else                                                        \
+        mod_iterate1(nx, na, ix, ia)                            \
+            DPQ1_ELEMENT(x[ix], a[ia], CALL)
+
 static SEXP dpq1_1(SEXP sx, SEXP sa, SEXP sI, double (*f)())
 {
     SEXP sy;
@@ -93,17 +314,7 @@ static SEXP dpq1_1(SEXP sx, SEXP sa, SEXP sI, double (*f)())
 
     i_1 = asInteger(sI);
 
-    mod_iterate1(nx, na, ix, ia)
-    {
-        xi = x[ix];
-        ai = a[ia];
-        if_NA_dpq1_set(y[i], xi, ai)
-        else
-        {
-            y[i] = f(xi, ai, i_1);
-            if (ISNAN(y[i])) naflag = TRUE;
-        }
-    }
+    ITERATE_DPQ1(f(xi, ai, i_1));
 
 #define FINISH_DPQ1                             \
     if (naflag)                                 \
@@ -137,17 +348,7 @@ static SEXP dpq1_2(SEXP sx, SEXP sa, SEXP sI, SEXP sJ, double (*f)())
     i_1 = asInteger(sI);
     i_2 = asInteger(sJ);
 
-    mod_iterate1(nx, na, ix, ia)
-    {
-        xi = x[ix];
-        ai = a[ia];
-        if_NA_dpq1_set(y[i], xi, ai)
-        else
-        {
-            y[i] = f(xi, ai, i_1, i_2);
-            if (ISNAN(y[i])) naflag = TRUE;
-        }
-    }
+    ITERATE_DPQ1(f(xi, ai, i_1, i_2));
 
     FINISH_DPQ1;
 
@@ -156,14 +357,16 @@ static SEXP dpq1_2(SEXP sx, SEXP sa, SEXP sI, SEXP sJ, double (*f)())
 
 #define DPQ1_1(A, FUN) dpq1_1(CAR(A), CADR(A), CADDR(A), FUN);
 #define DPQ1_2(A, FUN) dpq1_2(CAR(A), CADR(A), CADDR(A), CADDDR(A), FUN)
+#define DPQ1_1B(A, FUN, BFUN) (dpq_batch_ok(A, 1) ? dpq_batch(A, 1, 1, BFUN) : dpq1_1(CAR(A), CADR(A), CADDR(A), FUN))
+#define DPQ1_2B(A, FUN, BFUN) (dpq_batch_ok(A, 1) ? dpq_batch(A, 1, 2, BFUN) : DPQ1_2(A, FUN))
 
 SEXP actuar_do_dpq1(int code, SEXP args)
 {
     switch (code)
     {
     case   1: return DPQ1_1(args, mexp);
-    case   2: return DPQ1_1(args, dinvexp);
-    case   3: return DPQ1_2(args, pinvexp);
+    case   2: return DPQ1_1B(args, dinvexp, dinvexp_batch);
+    case   3: return DPQ1_2B(args, pinvexp, pinvexp_batch);
     case   4: return DPQ1_2(args, qinvexp);
     case   5: return DPQ1_1(args, minvexp);
     case   6: return DPQ1_1(args, mgfexp);
@@ -197,6 +400,36 @@ SEXP actuar_do_dpq1(int code, SEXP args)
              i3 = (++i3 == n3) ? 0 : i3,        \
              ++i)
 
+#define DPQ2_ELEMENT(X, A, B, CALL)                             \
+    {                                                           \
+        xi = X;                                                 \
+        ai = A;                                                 \
+        bi = B;                                                 \
+        if_NA_dpq2_set(y[i], xi, ai, bi)                        \
+        else                                                    \
+        {                                                       \
+            y[i] = CALL;                                        \
+            if (ISNAN(y[i])) naflag = TRUE;                     \
+        }                                                       \
+    }
+
+#define ITERATE_DPQ2(CALL)                                      \
+    if (dpq_threads(n) > 1)                                     \
+    {                                                           \
+        DPQ_OMP_FOR(xi, ai, bi)                                 \
+        for (i = 0; i < n; i++)                                 \
+            DPQ2_ELEMENT(x[i % nx], a[i % na], b[i % nb], CALL) \
+    }                                                           \
+    else if (na == 1 && nb == 1)                                \
+        for (i = 0; i < n; i++)                                 \
+            DPQ2_ELEMENT(x[i], a[0], b[0], CALL)                \
+    else if (nx == n && na == n && nb == n)                     \
+        for (i = 0; i < n; i++)                                 \
+            DPQ2_ELEMENT(x[i], a[i], b[i], CALL)                \
+    else                                                        \
+        mod_iterate2(nx, na, nb, ix, ia, ib)                    \
+            DPQ2_ELEMENT(x[ix], a[ia], b[ib], CALL)
+
 static SEXP dpq2_1(SEXP sx, SEXP sa, SEXP sb, SEXP sI, double (*f)())
 {
     SEXP sy;
@@ -232,18 +465,7 @@ static SEXP dpq2_1(SEXP sx, SEXP sa, SEXP sb, SEXP sI, double (*f)())
 
     i_1 = asInteger(sI);
 
-    mod_iterate2(nx, na, nb, ix, ia, ib)
-    {
-        xi = x[ix];
-        ai = a[ia];
-        bi = b[ib];
-        if_NA_dpq2_set(y[i], xi, ai, bi)
-        else
-        {
-            y[i] = f(xi, ai, bi, i_1);
-            if (ISNAN(y[i])) naflag = TRUE;
-        }
-    }
+    ITERATE_DPQ2(f(xi, ai, bi, i_1));
 
 #define FINISH_DPQ2                             \
     if (naflag)                                 \
@@ -282,18 +504,7 @@ static SEXP dpq2_2(SEXP sx, SEXP sa, SEXP sb, SEXP sI, SEXP sJ, double (*f)())
     i_1 = asInteger(sI);
     i_2 = asInteger(sJ);
 
-    mod_iterate2(nx, na, nb, ix, ia, ib)
-    {
-        xi = x[ix];
-        ai = a[ia];
-        bi = b[ib];
-        if_NA_dpq2_set(y[i], xi, ai, bi)
-        else
-        {
-            y[i] = f(xi, ai, bi, i_1, i_2);
-            if (ISNAN(y[i])) naflag = TRUE;
-        }
-    }
+    ITERATE_DPQ2(f(xi, ai, bi, i_1, i_2));
 
     FINISH_DPQ2;
 
@@ -322,18 +533,7 @@ static SEXP dpq2_5(SEXP sx, SEXP sa, SEXP sb, SEXP sI, SEXP sJ,
     i_4 = asInteger(sM);
     i_5 = asInteger(sE);
 
-    mod_iterate2(nx, na, nb, ix, ia, ib)
-    {
-        xi = x[ix];
-        ai = a[ia];
-        bi = b[ib];
-        if_NA_dpq2_set(y[i], xi, ai, bi)
-        else
-        {
-            y[i] = f(xi, ai, bi, i_1, i_2, d_3, i_4, i_5);
-            if (ISNAN(y[i])) naflag = TRUE;
-        }
-    }
+    ITERATE_DPQ2(f(xi, ai, bi, i_1, i_2, d_3, i_4, i_5));
 
     FINISH_DPQ2;
 
@@ -343,6 +543,8 @@ static SEXP dpq2_5(SEXP sx, SEXP sa, SEXP sb, SEXP sI, SEXP sJ,
 #define DPQ2_1(A, FUN) dpq2_1(CAR(A), CADR(A), CADDR(A), CADDDR(A), FUN);
 #define DPQ2_2(A, FUN) dpq2_2(CAR(A), CADR(A), CADDR(A), CADDDR(A), CAD4R(A), FUN)
 #define DPQ2_5(A, FUN) dpq2_5(CAR(A), CADR(A), CADDR(A), CADDDR(A), CAD4R(A), CAD5R(A), CAD6R(A), CAD7R(A), FUN)
+#define DPQ2_1B(A, FUN, BFUN) (dpq_batch_ok(A, 2) ? dpq_batch(A, 2, 1, BFUN) : dpq2_1(CAR(A), CADR(A), CADDR(A), CADDDR(A), FUN))
+#define DPQ2_2B(A, FUN, BFUN) (dpq_batch_ok(A, 2) ? dpq_batch(A, 2, 2, BFUN) : DPQ2_2(A, FUN))
 
 SEXP actuar_do_dpq2(int code, SEXP args)
 {
@@ -353,37 +555,37 @@ SEXP actuar_do_dpq2(int code, SEXP args)
     case   3: return DPQ2_2(args, pinvgamma);
     case   4: return DPQ2_2(args, qinvgamma);
     case   5: return DPQ2_1(args, minvgamma);
-    case   6: return DPQ2_1(args, dinvparalogis);
-    case   7: return DPQ2_2(args, pinvparalogis);
+    case   6: return DPQ2_1B(args, dinvparalogis, dinvparalogis_batch);
+    case   7: return DPQ2_2B(args, pinvparalogis, pinvparalogis_batch);
     case   8: return DPQ2_2(args, qinvparalogis);
     case   9: return DPQ2_1(args, minvparalogis);
-    case  10: return DPQ2_1(args, dinvpareto);
-    case  11: return DPQ2_2(args, pinvpareto);
+    case  10: return DPQ2_1B(args, dinvpareto, dinvpareto_batch);
+    case  11: return DPQ2_2B(args, pinvpareto, pinvpareto_batch);
     case  12: return DPQ2_2(args, qinvpareto);
     case  13: return DPQ2_1(args, minvpareto);
-    case  14: return DPQ2_1(args, dinvweibull);
-    case  15: return DPQ2_2(args, pinvweibull);
+    case  14: return DPQ2_1B(args, dinvweibull, dinvweibull_batch);
+    case  15: return DPQ2_2B(args, pinvweibull, pinvweibull_batch);
     case  16: return DPQ2_2(args, qinvweibull);
     case  17: return DPQ2_1(args, minvweibull);
     case  18: return DPQ2_1(args, dlgamma);
     case  19: return DPQ2_2(args, plgamma);
     case  20: return DPQ2_2(args, qlgamma);
     case  21: return DPQ2_2(args, mlgamma);
-    case  22: return DPQ2_1(args, dllogis);
-    case  23: return DPQ2_2(args, pllogis);
+    case  22: return DPQ2_1B(args, dllogis, dllogis_batch);
+    case  23: return DPQ2_2B(args, pllogis, pllogis_batch);
     case  24: return DPQ2_2(args, qllogis);
     case  25: return DPQ2_1(args, mllogis);
     case  26: return DPQ2_1(args, mlnorm);
-    case  27: return DPQ2_1(args, dparalogis);
-    case  28: return DPQ2_2(args, pparalogis);
+    case  27: return DPQ2_1B(args, dparalogis, dparalogis_batch);
+    case  28: return DPQ2_2B(args, pparalogis, pparalogis_batch);
     case  29: return DPQ2_2(args, qparalogis);
     case  30: return DPQ2_1(args, mparalogis);
-    case  31: return DPQ2_1(args, dpareto);
-    case  32: return DPQ2_2(args, ppareto);
+    case  31: return DPQ2_1B(args, dpareto, dpareto_batch);
+    case  32: return DPQ2_2B(args, ppareto, ppareto_batch);
     case  33: return DPQ2_2(args, qpareto);
     case  34: return DPQ2_1(args, mpareto);
-    case  35: return DPQ2_1(args, dpareto1);
-    case  36: return DPQ2_2(args, ppareto1);
+    case  35: return DPQ2_1B(args, dpareto1, dpareto1_batch);
+    case  36: return DPQ2_2B(args, ppareto1, ppareto1_batch);
     case  37: return DPQ2_2(args, qpareto1);
     case  38: return DPQ2_1(args, mpareto1);
     case  39: return DPQ2_1(args, mweibull);
@@ -451,6 +653,37 @@ SEXP actuar_do_dpq2(int code, SEXP args)
              i4 = (++i4 == n4) ? 0 : i4,                \
              ++i)
 
+#define DPQ3_ELEMENT(X, A, B, C, CALL)                          \
+    {                                                           \
+        xi = X;                                                 \
+        ai = A;                                                 \
+        bi = B;                                                 \
+        ci = C;                                                 \
+        if_NA_dpq3_set(y[i], xi, ai, bi, ci)                    \
+        else                                                    \
+        {                                                       \
+            y[i] = CALL;                                        \
+            if (ISNAN(y[i])) naflag = TRUE;                     \
+        }                                                       \
+    }
+
+#define ITERATE_DPQ3(CALL)                                      \
+    if (dpq_threads(n) > 1)                                     \
+    {                                                           \
+        DPQ_OMP_FOR(xi, ai, bi, ci)                             \
+        for (i = 0; i < n; i++)                                 \
+            DPQ3_ELEMENT(x[i % nx], a[i % na], b[i % nb], c[i % nc], CALL)\
+    }                                                           \
+    else if (na == 1 && nb == 1 && nc == 1)                     \
+        for (i = 0; i < n; i++)                                 \
+            DPQ3_ELEMENT(x[i], a[0], b[0], c[0], CALL)          \
+    else if (nx == n && na == n && nb == n && nc == n)          \
+        for (i = 0; i < n; i++)                                 \
+            DPQ3_ELEMENT(x[i], a[i], b[i], c[i], CALL)          \
+    else                                                        \
+        mod_iterate3(nx, na, nb, nc, ix, ia, ib, ic)            \
+            DPQ3_ELEMENT(x[ix], a[ia], b[ib], c[ic], CALL)
+
 static SEXP dpq3_1(SEXP sx, SEXP sa, SEXP sb, SEXP sc, SEXP sI, double (*f)())
 {
     SEXP sy;
@@ -490,19 +723,7 @@ static SEXP dpq3_1(SEXP sx, SEXP sa, SEXP sb, SEXP sc, SEXP sI, double (*f)())
 
     i_1 = asInteger(sI);
 
-    mod_iterate3(nx, na, nb, nc, ix, ia, ib, ic)
-    {
-        xi = x[ix];
-        ai = a[ia];
-        bi = b[ib];
-        ci = c[ic];
-        if_NA_dpq3_set(y[i], xi, ai, bi, ci)
-        else
-        {
-            y[i] = f(xi, ai, bi, ci, i_1);
-            if (ISNAN(y[i])) naflag = TRUE;
-        }
-    }
+    ITERATE_DPQ3(f(xi, ai, bi, ci, i_1));
 
 #define FINISH_DPQ3                             \
     if (naflag)                                 \
@@ -546,19 +767,7 @@ static SEXP dpq3_2(SEXP sx, SEXP sa, SEXP sb, SEXP sc, SEXP sI, SEXP sJ, double
     i_1 = asInteger(sI);
     i_2 = asInteger(sJ);
 
-    mod_iterate3(nx, na, nb, nc, ix, ia, ib, ic)
-    {
-        xi = x[ix];
-        ai = a[ia];
-        bi = b[ib];
-        ci = c[ic];
-        if_NA_dpq3_set(y[i], xi, ai, bi, ci)
-        else
-        {
-            y[i] = f(xi, ai, bi, ci, i_1, i_2);
-            if (ISNAN(y[i])) naflag = TRUE;
-        }
-    }
+    ITERATE_DPQ3(f(xi, ai, bi, ci, i_1, i_2));
 
     FINISH_DPQ3;
 
@@ -567,21 +776,23 @@ static SEXP dpq3_2(SEXP sx, SEXP sa, SEXP sb, SEXP sc, SEXP sI, SEXP sJ, double
 
 #define DPQ3_1(A, FUN) dpq3_1(CAR(A), CADR(A), CADDR(A), CADDDR(A), CAD4R(A), FUN);
 #define DPQ3_2(A, FUN) dpq3_2(CAR(A), CADR(A), CADDR(A), CADDDR(A), CAD4R(A), CAD5R(A), FUN)
+#define DPQ3_1B(A, FUN, BFUN) (dpq_batch_ok(A, 3) ? dpq_batch(A, 3, 1, BFUN) : dpq3_1(CAR(A), CADR(A), CADDR(A), CADDDR(A), CAD4R(A), FUN))
+#define DPQ3_2B(A, FUN, BFUN) (dpq_batch_ok(A, 3) ? dpq_batch(A, 3, 2, BFUN) : DPQ3_2(A, FUN))
 
 SEXP actuar_do_dpq3(int code, SEXP args)
 {
     switch (code)
     {
-    case   1:  return DPQ3_1(args, dburr);
-    case   2:  return DPQ3_2(args, pburr);
+    case   1:  return DPQ3_1B(args, dburr, dburr_batch);
+    case   2:  return DPQ3_2B(args, pburr, pburr_batch);
     case   3:  return DPQ3_2(args, qburr);
     case   4:  return DPQ3_1(args, mburr);
     case   5:  return DPQ3_1(args, dgenpareto);
     case   6:  return DPQ3_2(args, pgenpareto);
     case   7:  return DPQ3_2(args, qgenpareto);
     case   8:  return DPQ3_1(args, mgenpareto);
-    case   9:  return DPQ3_1(args, dinvburr);
-    case  10:  return DPQ3_2(args, pinvburr);
+    case   9:  return DPQ3_1B(args, dinvburr, dinvburr_batch);
+    case  10:  return DPQ3_2B(args, pinvburr, pinvburr_batch);
     case  11:  return DPQ3_2(args, qinvburr);
     case  12:  return DPQ3_1(args, minvburr);
     case  13:  return DPQ3_1(args, dinvtrgamma);
@@ -640,6 +851,38 @@ SEXP actuar_do_dpq3(int code, SEXP args)
              i5 = (++i5 == n5) ? 0 : i5,                        \
              ++i)
 
+#define DPQ4_ELEMENT(X, A, B, C, D, CALL)                       \
+    {                                                           \
+        xi = X;                                                 \
+        ai = A;                                                 \
+        bi = B;                                                 \
+        ci = C;                                                 \
+        di = D;                                                 \
+        if_NA_dpq4_set(y[i], xi, ai, bi, ci, di)                \
+        else                                                    \
+        {                                                       \
+            y[i] = CALL;                                        \
+            if (ISNAN(y[i])) naflag = TRUE;                     \
+        }                                                       \
+    }
+
+#define ITERATE_DPQ4(CALL)                                      \
+    if (dpq_threads(n) > 1)                                     \
+    {                                                           \
+        DPQ_OMP_FOR(xi, ai, bi, ci, di)                         \
+        for (i = 0; i < n; i++)                                 \
+            DPQ4_ELEMENT(x[i % nx], a[i % na], b[i % nb], c[i % nc], d[i % nd], CALL)\
+    }                                                           \
+    else if (na == 1 && nb == 1 && nc == 1 && nd == 1)          \
+        for (i = 0; i < n; i++)                                 \
+            DPQ4_ELEMENT(x[i], a[0], b[0], c[0], d[0], CALL)    \
+    else if (nx == n && na == n && nb == n && nc == n && nd == n)\
+        for (i = 0; i < n; i++)                                 \
+            DPQ4_ELEMENT(x[i], a[i], b[i], c[i], d[i], CALL)    \
+    else                                                        \
+        mod_iterate4(nx, na, nb, nc, nd, ix, ia, ib, ic, id)    \
+            DPQ4_ELEMENT(x[ix], a[ia], b[ib], c[ic], d[id], CALL)
+
 static SEXP dpq4_1(SEXP sx, SEXP sa, SEXP sb, SEXP sc, SEXP sd, SEXP sI, double (*f)())
 {
     SEXP sy;
@@ -685,20 +928,7 @@ static SEXP dpq4_1(SEXP sx, SEXP sa, SEXP sb, SEXP sc, SEXP sd, SEXP sI, double
 
     i_1 = asInteger(sI);
 
-    mod_iterate4(nx, na, nb, nc, nd, ix, ia, ib, ic, id)
-    {
-        xi = x[ix];
-        ai = a[ia];
-        bi = b[ib];
-        ci = c[ic];
-        di = d[id];
-        if_NA_dpq4_set(y[i], xi, ai, bi, ci, di)
-        else
-        {
-            y[i] = f(xi, ai, bi, ci, di, i_1);
-            if (ISNAN(y[i])) naflag = TRUE;
-        }
-    }
+    ITERATE_DPQ4(f(xi, ai, bi, ci, di, i_1));
 
 #define FINISH_DPQ4                             \
     if (naflag)                                 \
@@ -746,20 +976,7 @@ static SEXP dpq4_2(SEXP sx, SEXP sa, SEXP sb, SEXP sc, SEXP sd, SEXP sI, SEXP sJ
     i_1 = asInteger(sI);
     i_2 = asInteger(sJ);
 
-    mod_iterate4(nx, na, nb, nc, nd, ix, ia, ib, ic, id)
-    {
-        xi = x[ix];
-        ai = a[ia];
-        bi = b[ib];
-        ci = c[ic];
-        di = d[id];
-        if_NA_dpq4_set(y[i], xi, ai, bi, ci, di)
-        else
-        {
-            y[i] = f(xi, ai, bi, ci, di, i_1, i_2);
-            if (ISNAN(y[i])) naflag = TRUE;
-        }
-    }
+    ITERATE_DPQ4(f(xi, ai, bi, ci, di, i_1, i_2));
 
     FINISH_DPQ4;
 
@@ -810,6 +1027,39 @@ SEXP actuar_do_dpq4(int code, SEXP args)
              i6 = (++i6 == n6) ? 0 : i6,                        \
              ++i)
 
+#define DPQ5_ELEMENT(X, A, B, C, D, E, CALL)                    \
+    {                                                           \
+        xi = X;                                                 \
+        ai = A;                                                 \
+        bi = B;                                                 \
+        ci = C;                                                 \
+        di = D;                                                 \
+        ei = E;                                                 \
+        if_NA_dpq5_set(y[i], xi, ai, bi, ci, di, ei)            \
+        else                                                    \
+        {                                                       \
+            y[i] = CALL;                                        \
+            if (ISNAN(y[i])) naflag = TRUE;                     \
+        }                                                       \
+    }
+
+#define ITERATE_DPQ5(CALL)                                      \
+    if (dpq_threads(n) > 1)                                     \
+    {                                                           \
+        DPQ_OMP_FOR(xi, ai, bi, ci, di, ei)                     \
+        for (i = 0; i < n; i++)                                 \
+            DPQ5_ELEMENT(x[i % nx], a[i % na], b[i % nb], c[i % nc], d[i % nd], e[i % ne], CALL)\
+    }                                                           \
+    else if (na == 1 && nb == 1 && nc == 1 && nd == 1 && ne == 1)\
+        for (i = 0; i < n; i++)                                 \
+            DPQ5_ELEMENT(x[i], a[0], b[0], c[0], d[0], e[0], CALL)\
+    else if (nx == n && na == n && nb == n && nc == n && nd == n && ne == n)\
+        for (i = 0; i < n; i++)                                 \
+            DPQ5_ELEMENT(x[i], a[i], b[i], c[i], d[i], e[i], CALL)\
+    else                                                        \
+        mod_iterate5(nx, na, nb, nc, nd, ne, ix, ia, ib, ic, id, ie)\
+            DPQ5_ELEMENT(x[ix], a[ia], b[ib], c[ic], d[id], e[ie], CALL)
+
 static SEXP dpq5_1(SEXP sx, SEXP sa, SEXP sb, SEXP sc, SEXP sd, SEXP se, SEXP sI, double (*f)())
 {
     SEXP sy;
@@ -859,21 +1109,7 @@ static SEXP dpq5_1(SEXP sx, SEXP sa, SEXP sb, SEXP sc, SEXP sd, SEXP se, SEXP sI
 
     i_1 = asInteger(sI);
 
-    mod_iterate5(nx, na, nb, nc, nd, ne, ix, ia, ib, ic, id, ie)
-    {
-        xi = x[ix];
-        ai = a[ia];
-        bi = b[ib];
-        ci = c[ic];
-        di = d[id];
-        ei = e[ie];
-        if_NA_dpq5_set(y[i], xi, ai, bi, ci, di, ei)
-        else
-        {
-            y[i] = f(xi, ai, bi, ci, di, ei, i_1);
-            if (ISNAN(y[i])) naflag = TRUE;
-        }
-    }
+    ITERATE_DPQ5(f(xi, ai, bi, ci, di, ei, i_1));
 
 #define FINISH_DPQ5                             \
     if (naflag)                                 \
@@ -926,23 +1162,69 @@ SEXP actuar_do_dpq5(int code, SEXP args)
 }
 
 
+/* Look up of a distribution name in dpq_tab. The names are string
+ * constants in the R functions, hence the same CHARSXP from the
+ * global cache at every call. The position in dpq_tab found by the
+ * first (linear) search for a name is stored in a hash table indexed
+ * by the address of the CHARSXP, which is protected for the session
+ * so the address cannot be reused. Subsequent calls thus cost a
+ * single probe. Value is -1 for an unknown name. */
+#define DPQ_CACHE_SIZE 1024     /* power of 2, more than twice dpq_tab */
+
+static struct {
+    SEXP name;
+    int index;
+} dpq_cache[DPQ_CACHE_SIZE];
+static int dpq_ncache = 0;
+
+int actuar_dpq_lookup(SEXP name)
+{
+    int i;
+    unsigned int h = ((uintptr_t) name >> 4) & (DPQ_CACHE_SIZE - 1);
+    const char *s;
+
+    while (dpq_cache[h].name != NULL)
+    {
+        if (dpq_cache[h].name == name)
+            return dpq_cache[h].index;
+        h = (h + 1) & (DPQ_CACHE_SIZE - 1);
+    }
+
+    s = CHAR(name);
+    for (i = 0; dpq_tab[i].name; i++)
+        if (!strcmp(dpq_tab[i].name, s))
+            break;
+    if (!dpq_tab[i].name)
+        return -1;
+
+    /* Keep the table at most half full. */
+    if (dpq_ncache < DPQ_CACHE_SIZE / 2)
+    {
+        R_PreserveObject(name);
+        dpq_cache[h].name = name;
+        dpq_cache[h].index = i;
+        dpq_ncache++;
+    }
+
+    return i;
+}
+
 /* Main function, the only one used by .External(). */
 SEXP actuar_do_dpq(SEXP args)
 {
     int i;
-    const char *name;
 
     /* Extract distribution name */
     args = CDR(args);
-    name = CHAR(STRING_ELT(CAR(args), 0));
+    i = actuar_dpq_lookup(STRING_ELT(CAR(args), 0));
 
     /* Dispatch to actuar_do_dpq{1,2,3,4,5} */
-    for (i = 0; dpq_tab[i].name; i++)
+    if (i >= 0)
     {
-        if (!strcmp(dpq_tab[i].name, name))
-        {
-            return dpq_tab[i].cfun(dpq_tab[i].code, CDR(args));
-        }
+        dpq_nthreads = 1;
+        if (dpq_threadsafe(dpq_tab[i].name))
+            dpq_nthreads = actuar_threads_option(&dpq_minsize);
+        return dpq_tab[i].cfun(dpq_tab[i].code, CDR(args));
     }
 
     /* No dispatch is an error */
@@ -25,19 +25,79 @@
 #include <Rinternals.h>
 #include "actuar.h"
 #include "locale.h"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 #define if_NA_dpqphtype2_set(y, x)                              \
     if      (ISNA (x) || naargs) y = NA_REAL;                   \
     else if (ISNAN(x) || nanargs) y = R_NaN;                    \
     else if (naflag) y = R_NaN;
 
+/* The density and distribution functions are evaluated with their
+ * *_work() versions (argument 'fw'), in a workspace allocated once
+ * per thread rather than at each element. Threads are used as in
+ * dpq.c, only when the arguments passed the sanity checks. */
+#ifdef _OPENMP
+#define DPQPHTYPE2_THREAD omp_get_thread_num()
+#else
+#define DPQPHTYPE2_THREAD 0
+#endif
 
-static SEXP dpqphtype2_1(SEXP sx, SEXP sa, SEXP sb, SEXP sI, double (*f)())
+#define SETUP_DPQPHTYPE2_WORK                                           \
+    nth = 1;                                                            \
+    if (!(naargs || nanargs || naflag))                                 \
+    {                                                                   \
+        nthreads = actuar_threads_option(&minsize);                     \
+        if (n >= minsize)                                               \
+            nth = nthreads;                                             \
+    }                                                                   \
+    dwork = (double *) R_alloc(nth * PHTYPE_DWORK(m), sizeof(double));  \
+    iwork = (int *) R_alloc(nth * PHTYPE_IWORK(m), sizeof(int))
+
+/* With valid parameters, the density and distribution functions are
+ * evaluated on the grid of the positive and finite elements of x
+ * with the *_grid() versions (argument 'fg'), which step forward
+ * across the sorted values; see phtype.c. The sorted values are
+ * split in chunks of PHTYPE_GRID_CHUNK points, each starting afresh,
+ * so that errors do not accumulate across long grids and the chunks
+ * may be evaluated in threads with results identical to serial
+ * evaluation. The other elements are evaluated with the *_work()
+ * versions. */
+#define SETUP_DPQPHTYPE2_GRID                                           \
+    nth = 1;                                                            \
+    nthreads = actuar_threads_option(&minsize);                         \
+    if (n >= minsize)                                                   \
+        nth = nthreads;                                                 \
+    dwork = (double *) R_alloc(nth * PHTYPE_GRID_DWORK(m), sizeof(double)); \
+    iwork = (int *) R_alloc(nth * PHTYPE_IWORK(m), sizeof(int));        \
+    xs = (double *) R_alloc(n, sizeof(double));                         \
+    ord = (int *) R_alloc(n, sizeof(int));                              \
+    for (i = 0, ng = 0; i < n; i++)                                     \
+        if (R_FINITE(x[i]) && x[i] > 0.0)                               \
+        {                                                               \
+            xs[ng] = x[i];                                              \
+            ord[ng++] = i;                                              \
+        }                                                               \
+    rsort_with_index(xs, ord, ng);                                      \
+    nchunk = (ng + PHTYPE_GRID_CHUNK - 1) / PHTYPE_GRID_CHUNK
+
+#define FINISH_DPQPHTYPE2_GRID                  \
+    for (i = 0; i < ng; i++)                    \
+        if (ISNAN(y[ord[i]])) naflag = TRUE
+
+
+static SEXP dpqphtype2_1(SEXP sx, SEXP sa, SEXP sb, SEXP sI, double (*f)(),
+                         double (*fw)(), void (*fg)())
 {
     SEXP sy, bdims;
     int i, j, ij, n, m, sxo = OBJECT(sx);
     double tmp1, tmp2, *x, *a, *b, *y;
     int i_1;
+    int k, nth, nthreads, minsize, *iwork;
+    double *dwork;
+    int c, ng, nchunk, *ord;
+    double *xs;
 
     /* Flags used in sanity check of arguments. Listed from highest to
      * lowest priority. */
@@ -99,15 +159,67 @@ static SEXP dpqphtype2_1(SEXP sx, SEXP sa, SEXP sb, SEXP sI, double (*f)())
     SETUP_DPQPHTYPE2;
 
     i_1 = asInteger(sI);
-    for (i = 0; i < n; i++)
+    if (fg && !(naargs || nanargs || naflag))
     {
-        if_NA_dpqphtype2_set(y[i], x[i])
-        else
+        SETUP_DPQPHTYPE2_GRID;
+
+        for (i = 0; i < n; i++)
         {
-            y[i] = f(x[i], a, b, m, i_1);
-            if (ISNAN(y[i])) naflag = TRUE;
+            if (R_FINITE(x[i]) && x[i] > 0.0)
+                continue;
+            if_NA_dpqphtype2_set(y[i], x[i])
+            else
+            {
+                y[i] = fw(x[i], a, b, m, i_1, dwork, iwork);
+                if (ISNAN(y[i])) naflag = TRUE;
+            }
+        }
+
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(nth) private(k) schedule(dynamic)
+#endif
+        for (c = 0; c < nchunk; c++)
+        {
+            k = DPQPHTYPE2_THREAD;
+            fg(xs + c * PHTYPE_GRID_CHUNK, ord + c * PHTYPE_GRID_CHUNK,
+               (c < nchunk - 1) ? PHTYPE_GRID_CHUNK : ng - c * PHTYPE_GRID_CHUNK,
+               a, b, m, i_1, y,
+               dwork + k * PHTYPE_GRID_DWORK(m),
+               iwork + k * PHTYPE_IWORK(m));
+        }
+
+        FINISH_DPQPHTYPE2_GRID;
+    }
+    else if (fw)
+    {
+        SETUP_DPQPHTYPE2_WORK;
+
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(nth) private(k) reduction(||:naflag)
+#endif
+        for (i = 0; i < n; i++)
+        {
+            k = DPQPHTYPE2_THREAD;
+            if_NA_dpqphtype2_set(y[i], x[i])
+            else
+            {
+                y[i] = fw(x[i], a, b, m, i_1,
+                          dwork + k * PHTYPE_DWORK(m),
+                          iwork + k * PHTYPE_IWORK(m));
+                if (ISNAN(y[i])) naflag = TRUE;
+            }
         }
     }
+    else
+        for (i = 0; i < n; i++)
+        {
+            if_NA_dpqphtype2_set(y[i], x[i])
+            else
+            {
+                y[i] = f(x[i], a, b, m, i_1);
+                if (ISNAN(y[i])) naflag = TRUE;
+            }
+        }
 
 #define FINISH_DPQPHTYPE2                               \
     if (naflag)                                         \
@@ -123,12 +235,17 @@ static SEXP dpqphtype2_1(SEXP sx, SEXP sa, SEXP sb, SEXP sI, double (*f)())
     return sy;
 }
 
-static SEXP dpqphtype2_2(SEXP sx, SEXP sa, SEXP sb, SEXP sI, SEXP sJ, double (*f)())
+static SEXP dpqphtype2_2(SEXP sx, SEXP sa, SEXP sb, SEXP sI, SEXP sJ,
+                         double (*f)(), double (*fw)(), void (*fg)())
 {
     SEXP sy, bdims;
     int i, j, ij, n, m, sxo = OBJECT(sx);
     double tmp1, tmp2, *x, *a, *b, *y;
     int i_1, i_2;
+    int k, nth, nthreads, minsize, *iwork;
+    double *dwork;
+    int c, ng, nchunk, *ord;
+    double *xs;
 
     /* Flags used in sanity check of arguments. Listed from highest to
      * lowest priority. */
@@ -138,32 +255,245 @@ static SEXP dpqphtype2_2(SEXP sx, SEXP sa, SEXP sb, SEXP sI, SEXP sJ, double (*f
 
     i_1 = asInteger(sI);
     i_2 = asInteger(sJ);
+    if (fg && !(naargs || nanargs || naflag))
+    {
+        SETUP_DPQPHTYPE2_GRID;
+
+        for (i = 0; i < n; i++)
+        {
+            if (R_FINITE(x[i]) && x[i] > 0.0)
+                continue;
+            if_NA_dpqphtype2_set(y[i], x[i])
+            else
+            {
+                y[i] = fw(x[i], a, b, m, i_1, i_2, dwork, iwork);
+                if (ISNAN(y[i])) naflag = TRUE;
+            }
+        }
+
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(nth) private(k) schedule(dynamic)
+#endif
+        for (c = 0; c < nchunk; c++)
+        {
+            k = DPQPHTYPE2_THREAD;
+            fg(xs + c * PHTYPE_GRID_CHUNK, ord + c * PHTYPE_GRID_CHUNK,
+               (c < nchunk - 1) ? PHTYPE_GRID_CHUNK : ng - c * PHTYPE_GRID_CHUNK,
+               a, b, m, i_1, i_2, y,
+               dwork + k * PHTYPE_GRID_DWORK(m),
+               iwork + k * PHTYPE_IWORK(m));
+        }
+
+        FINISH_DPQPHTYPE2_GRID;
+    }
+    else if (fw)
+    {
+        SETUP_DPQPHTYPE2_WORK;
+
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(nth) private(k) reduction(||:naflag)
+#endif
+        for (i = 0; i < n; i++)
+        {
+            k = DPQPHTYPE2_THREAD;
+            if_NA_dpqphtype2_set(y[i], x[i])
+            else
+            {
+                y[i] = fw(x[i], a, b, m, i_1, i_2,
+                          dwork + k * PHTYPE_DWORK(m),
+                          iwork + k * PHTYPE_IWORK(m));
+                if (ISNAN(y[i])) naflag = TRUE;
+            }
+        }
+    }
+    else
+        for (i = 0; i < n; i++)
+        {
+            if_NA_dpqphtype2_set(y[i], x[i])
+            else
+            {
+                y[i] = f(x[i], a, b, m, i_1, i_2);
+                if (ISNAN(y[i])) naflag = TRUE;
+            }
+        }
+
+    FINISH_DPQPHTYPE2;
+
+    return sy;
+}
+
+/* Sub-intensity matrix in the compact form of a list with components
+ * 'diag', 'super' and, optionally, 'u' and 'v'; see phtype.c. The
+ * positive and finite values of x are sorted once for the density
+ * and distribution functions. */
+static SEXP phtype_list_elt(SEXP list, const char *name)
+{
+    int i;
+    SEXP names = getAttrib(list, R_NamesSymbol);
+
+    if (!isNull(names))
+        for (i = 0; i < LENGTH(list); i++)
+            if (!strcmp(CHAR(STRING_ELT(names, i)), name))
+                return VECTOR_ELT(list, i);
+    return R_NilValue;
+}
+
+static SEXP dpqphtype2_bidiag(int code, SEXP args)
+{
+    SEXP sx, sa, sb, sy, sd, ss, su, sv;
+    int i, n, m, ng, *ord, i_1, i_2 = 0, nprot = 5,
+        sxo = OBJECT(CAR(args));
+    double tmp1, vsum, *x, *a, *y, *xs, *dwork;
+    phtype_bidiag_struct T;
+
+    /* Flags used in sanity check of arguments. Listed from highest to
+     * lowest priority. */
+    Rboolean naargs = FALSE, nanargs = FALSE, naflag = FALSE;
+
+    sx = CAR(args);
+    sa = CADR(args);
+    sb = CADDR(args);
+    sd = phtype_list_elt(sb, "diag");
+    ss = phtype_list_elt(sb, "super");
+    su = phtype_list_elt(sb, "u");
+    sv = phtype_list_elt(sb, "v");
+    if (!isNumeric(sx) || !isNumeric(sa) || !isNumeric(sd) ||
+        !(isNull(ss) || isNumeric(ss)) || isNull(su) != isNull(sv) ||
+        !(isNull(su) || (isNumeric(su) && isNumeric(sv))))
+        error(_("invalid arguments"));
+
+    n = LENGTH(sx);
+    if (n == 0)
+        return(allocVector(REALSXP, 0));
+
+    m = LENGTH(sa);
+    if (m == 0 || LENGTH(sd) != m || LENGTH(ss) != m - 1 ||
+        (!isNull(su) && (LENGTH(su) != m || LENGTH(sv) != m)))
+        naflag = TRUE;
+
+    PROTECT(sx = coerceVector(sx, REALSXP));
+    PROTECT(sa = coerceVector(sa, REALSXP));
+    PROTECT(sd = coerceVector(sd, REALSXP));
+    PROTECT(ss = isNull(ss) ? allocVector(REALSXP, 0) :
+            coerceVector(ss, REALSXP));
+    if (!isNull(su))
+    {
+        PROTECT(su = coerceVector(su, REALSXP));
+        PROTECT(sv = coerceVector(sv, REALSXP));
+        nprot += 2;
+    }
+    PROTECT(sy = allocVector(REALSXP, n));
+    x = REAL(sx);
+    a = REAL(sa);
+    y = REAL(sy);
+
+    T.m = m;
+    T.d = REAL(sd);
+    T.s = REAL(ss);
+    T.u = isNull(su) ? NULL : REAL(su);
+    T.v = isNull(su) ? NULL : REAL(sv);
+    T.scale = 1.0;
+
+    /* Same conditions as for a dense matrix: off-diagonal elements
+     * nonnegative, diagonal elements negative, nonpositive row sums
+     * and total initial probability at most 1. */
+    tmp1 = vsum = 0.0;
+    if (!naflag && T.u)
+        for (i = 0; i < m && !naargs && !nanargs; i++)
+        {
+            if ((naargs = ISNA(T.u[i]) || ISNA(T.v[i])))
+                break;
+            if ((nanargs = ISNAN(T.u[i]) || ISNAN(T.v[i])))
+                break;
+            if ((naflag = T.u[i] < 0 || T.v[i] < 0))
+                break;
+            vsum += T.v[i];
+        }
+    for (i = 0; i < m && !naargs && !nanargs && !naflag; i++)
+    {
+        if ((naargs = ISNA(a[i]) || ISNA(T.d[i]) ||
+             (i < m - 1 && ISNA(T.s[i]))))
+            break;
+        if ((nanargs = ISNAN(a[i]) || ISNAN(T.d[i]) ||
+             (i < m - 1 && ISNAN(T.s[i]))))
+            break;
+        tmp1 += a[i];
+        if ((naflag = (i < m - 1 && T.s[i] < 0) ||
+             T.d[i] + (T.u ? T.u[i] * T.v[i] : 0.0) >= 0 ||
+             T.d[i] + (i < m - 1 ? T.s[i] : 0.0) +
+             (T.u ? T.u[i] * vsum : 0.0) > 0))
+            break;
+    }
+    if (!(naargs || nanargs))
+        naflag = naflag || tmp1 > 1;
+
+    i_1 = asInteger(CADDDR(args));
+    if (code == 2)
+        i_2 = asInteger(CAD4R(args));
+
+    dwork = (double *) R_alloc(PHTYPE_BIDIAG_DWORK(m), sizeof(double));
+    xs = (double *) R_alloc(n, sizeof(double));
+    ord = (int *) R_alloc(n, sizeof(int));
+    ng = 0;
     for (i = 0; i < n; i++)
     {
         if_NA_dpqphtype2_set(y[i], x[i])
+        else if (code <= 2 && R_FINITE(x[i]) && x[i] > 0.0)
+        {
+            xs[ng] = x[i];
+            ord[ng++] = i;
+        }
         else
         {
-            y[i] = f(x[i], a, b, m, i_1, i_2);
+            switch (code)
+            {
+            case 1:
+                y[i] = dphtype_bidiag(x[i], a, &T, i_1, dwork);
+                break;
+            case 2:
+                y[i] = pphtype_bidiag(x[i], a, &T, i_1, i_2, dwork);
+                break;
+            case 3:
+                y[i] = mphtype_bidiag(x[i], a, &T, i_1, dwork);
+                break;
+            default:
+                y[i] = mgfphtype_bidiag(x[i], a, &T, i_1, dwork);
+            }
             if (ISNAN(y[i])) naflag = TRUE;
         }
     }
+    rsort_with_index(xs, ord, ng);
+    if (code == 1)
+        dphtype_bidiag_grid(xs, ord, ng, a, &T, i_1, y, dwork);
+    else if (code == 2)
+        pphtype_bidiag_grid(xs, ord, ng, a, &T, i_1, i_2, y, dwork);
+    for (i = 0; i < ng; i++)
+        if (ISNAN(y[ord[i]])) naflag = TRUE;
 
-    FINISH_DPQPHTYPE2;
+    if (naflag)
+        warning(R_MSG_NA);
 
+    SET_ATTRIB(sy, duplicate(ATTRIB(sx)));
+    SET_OBJECT(sy, sxo);
+
+    UNPROTECT(nprot);
     return sy;
 }
 
-#define DPQPHTYPE2_1(A, FUN) dpqphtype2_1(CAR(A), CADR(A), CADDR(A), CADDDR(A), FUN);
-#define DPQPHTYPE2_2(A, FUN) dpqphtype2_2(CAR(A), CADR(A), CADDR(A), CADDDR(A), CAD4R(A), FUN)
+#define DPQPHTYPE2_1(A, FUN, WFUN, GFUN) dpqphtype2_1(CAR(A), CADR(A), CADDR(A), CADDDR(A), FUN, WFUN, GFUN);
+#define DPQPHTYPE2_2(A, FUN, WFUN, GFUN) dpqphtype2_2(CAR(A), CADR(A), CADDR(A), CADDDR(A), CAD4R(A), FUN, WFUN, GFUN)
 
 SEXP actuar_do_dpqphtype2(int code, SEXP args)
 {
+    if (isNewList(CADDR(args)))
+        return dpqphtype2_bidiag(code, args);
+
     switch (code)
     {
-    case  1:  return DPQPHTYPE2_1(args, dphtype);
-    case  2:  return DPQPHTYPE2_2(args, pphtype);
-    case  3:  return DPQPHTYPE2_1(args, mphtype);
-    case  4:  return DPQPHTYPE2_1(args, mgfphtype);
+    case  1:  return DPQPHTYPE2_1(args, dphtype, dphtype_work, dphtype_grid);
+    case  2:  return DPQPHTYPE2_2(args, pphtype, pphtype_work, pphtype_grid);
+    case  3:  return DPQPHTYPE2_1(args, mphtype, NULL, NULL);
+    case  4:  return DPQPHTYPE2_1(args, mgfphtype, NULL, NULL);
     default:
         error(_("internal error in actuar_do_dpqphtype2"));
     }
@@ -175,16 +505,14 @@ SEXP actuar_do_dpqphtype2(int code, SEXP args)
 SEXP actuar_do_dpqphtype(SEXP args)
 {
     int i;
-    const char *name;
 
     /* Extract distribution name */
     args = CDR(args);
-    name = CHAR(STRING_ELT(CAR(args), 0));
+    i = actuar_dpq_lookup(STRING_ELT(CAR(args), 0));
 
     /* Dispatch to actuar_do_dpqphtype{1,2,3,4,5} */
-    for (i = 0; dpq_tab[i].name; i++)
-        if (!strcmp(dpq_tab[i].name, name))
-            return dpq_tab[i].cfun(dpq_tab[i].code, CDR(args));
+    if (i >= 0)
+        return dpq_tab[i].cfun(dpq_tab[i].code, CDR(args));
 
     /* No dispatch is an error */
     error("internal error in actuar_do_dpqphtype");
@@ -0,0 +1,271 @@
+/*  ===== actuar: An R Package for Actuarial Science =====
+ *
+ *  Maximum likelihood estimation for the distributions of the
+ *  package from individual data (possibly weighted, censored and
+ *  truncated) or from grouped data. The log-likelihood and its
+ *  gradient are computed by actuar_loglik() of loglik.c and
+ *  maximized by the BFGS method of R [vmmin()] on a transformed
+ *  scale where the parameters are unconstrained: logarithm for
+ *  positive parameters and logit for parameters in the unit
+ *  interval. The observed information matrix is computed at the
+ *  estimate by central differences of the gradient on the original
+ *  scale.
+ *
+ *  See ../R/fitloss.R for details.
+ *
+ *  AUTHOR: Vincent Goulet <vincent.goulet@act.ulaval.ca>
+ */
+
+#include <R.h>
+#include <Rinternals.h>
+#include <R_ext/Applic.h>
+#include "actuar.h"
+#include "locale.h"
+
+/* Additional access macros */
+#define CAD5R(e) CAR(CDR(CDR(CDR(CDR(CDR(e))))))
+#define CAD6R(e) CAR(CDR(CDR(CDR(CDR(CDR(CDR(e)))))))
+#define CAD7R(e) CAR(CDR(CDR(CDR(CDR(CDR(CDR(CDR(e))))))))
+#define CAD8R(e) CAR(CDR(CDR(CDR(CDR(CDR(CDR(CDR(CDR(e)))))))))
+#define CAD9R(e) CAR(CDR(CDR(CDR(CDR(CDR(CDR(CDR(CDR(CDR(e))))))))))
+
+/* Step of the central differences for the information matrix:
+ * DBL_EPSILON^(1/3), relative to the value of the parameter. */
+#define FITLOSS_NDERIV_EPS 6.0554544523933395e-06
+
+/* State of the optimization passed to the objective function and to
+ * the gradient through vmmin(). The value and the gradient are
+ * computed together and kept for the last point evaluated: vmmin()
+ * asks for the gradient at the point of the last accepted value. */
+typedef struct {
+    loglik_data_struct *data;
+    int nfree;			/* number of free parameters */
+    int *free;			/* indices of the free parameters */
+    double *par;		/* all the parameters, original scale */
+    double *eta;		/* free parameters, last point evaluated */
+    double *grad;		/* gradient of the log-likelihood */
+    double value;		/* minus the log-likelihood */
+    int cached;
+} fitloss_struct;
+
+/* Transformation of a parameter to the unconstrained scale and back;
+ * the inverse also returns the derivative of the parameter with
+ * respect to its transformation. */
+static double fitloss_transform(char domain, double p)
+{
+    switch (domain)
+    {
+    case 'p':
+	return log(p);
+    case 'u':
+	return log(p) - log1p(-p);
+    }
+    return p;
+}
+
+static double fitloss_untransform(char domain, double eta, double *deriv)
+{
+    double p;
+
+    switch (domain)
+    {
+    case 'p':
+	*deriv = p = exp(eta);
+	return p;
+    case 'u':
+	p = 1.0 / (1.0 + exp(-eta));
+	*deriv = p * (1.0 - p);
+	return p;
+    }
+    *deriv = 1.0;
+    return eta;
+}
+
+static void fitloss_eval(int n, double *eta, fitloss_struct *f)
+{
+    int j, k;
+    double l, deriv;
+
+    if (f->cached && !memcmp(eta, f->eta, n * sizeof(double)))
+	return;
+
+    for (j = 0; j < n; j++)
+    {
+	k = f->free[j];
+	f->par[k] = fitloss_untransform(f->data->d->domain[k], eta[j], &deriv);
+    }
+
+    l = actuar_loglik(f->data, f->par, f->grad);
+    f->value = R_FINITE(l) ? -l : R_PosInf;
+    Memcpy(f->eta, eta, n);
+    f->cached = 1;
+}
+
+static double fitloss_fn(int n, double *eta, void *ex)
+{
+    fitloss_struct *f = (fitloss_struct *) ex;
+
+    fitloss_eval(n, eta, f);
+    return f->value;
+}
+
+static void fitloss_gr(int n, double *eta, double *gr, void *ex)
+{
+    int j, k;
+    double deriv;
+    fitloss_struct *f = (fitloss_struct *) ex;
+
+    fitloss_eval(n, eta, f);
+    for (j = 0; j < n; j++)
+    {
+	k = f->free[j];
+	fitloss_untransform(f->data->d->domain[k], eta[j], &deriv);
+	gr[j] = -f->grad[k] * deriv;
+    }
+}
+
+/* Observed information matrix (minus the hessian of the
+ * log-likelihood) for the free parameters at 'f->par', by central
+ * differences of the gradient. One-sided differences are used next
+ * to the boundary of the parameter space. */
+static void fitloss_information(fitloss_struct *f, double *info)
+{
+    int i, j, k, l, n = f->nfree;
+    double p, h, lp, lm, *par = f->par;
+    double g[LOGLIK_MAXPAR], gp[LOGLIK_MAXPAR], gm[LOGLIK_MAXPAR];
+
+    actuar_loglik(f->data, par, g);
+
+    for (i = 0; i < n; i++)
+    {
+	k = f->free[i];
+	p = par[k];
+	h = FITLOSS_NDERIV_EPS * (fabs(p) + FITLOSS_NDERIV_EPS);
+	h = (p + h) - p;	/* exactly representable step */
+	par[k] = p + h;
+	lp = actuar_loglik(f->data, par, gp);
+	par[k] = p - h;
+	lm = actuar_loglik(f->data, par, gm);
+	par[k] = p;
+
+	for (j = 0; j < n; j++)
+	{
+	    l = f->free[j];
+	    if (R_FINITE(lp) && R_FINITE(lm))
+		info[i + j * n] = -(gp[l] - gm[l]) / (2.0 * h);
+	    else if (R_FINITE(lp))
+		info[i + j * n] = -(gp[l] - g[l]) / h;
+	    else if (R_FINITE(lm))
+		info[i + j * n] = -(g[l] - gm[l]) / h;
+	    else
+		info[i + j * n] = R_NaN;
+	}
+    }
+
+    /* symmetrize */
+    for (i = 0; i < n; i++)
+	for (j = 0; j < i; j++)
+	    info[i + j * n] = info[j + i * n] =
+		(info[i + j * n] + info[j + i * n]) / 2.0;
+}
+
+/* Arguments of .External(): the data as described in
+ * actuar_loglik_data() of loglik.c; starting values of the
+ * parameters; logical vector, whether each parameter is estimated;
+ * maximum number of iterations; relative convergence tolerance.
+ *
+ * Returns an unnamed list with the parameters at the maximum, the
+ * value of the log-likelihood, the observed information matrix of
+ * the free parameters, the number of evaluations of the
+ * log-likelihood and of its gradient, and the convergence code of
+ * vmmin(): 0 for success, 1 when the maximum number of iterations
+ * has been reached. */
+SEXP actuar_do_fitloss(SEXP args)
+{
+    SEXP spar, sfree, res, sest, sinfo, scounts;
+    loglik_data_struct data;
+    fitloss_struct f;
+    int j, npar, nfree, nprot, maxit, fncount, grcount, fail, *mask;
+    double reltol, Fmin, *eta, g[LOGLIK_MAXPAR];
+    char *domain;
+
+    args = CDR(args);
+    nprot = actuar_loglik_data(args, &data);
+    npar = data.d->npar;
+    domain = data.d->domain;
+
+    PROTECT(spar = coerceVector(CAD6R(args), REALSXP));
+    PROTECT(sfree = coerceVector(CAD7R(args), LGLSXP));
+    nprot += 2;
+    if (LENGTH(spar) != npar || LENGTH(sfree) != npar)
+	error(_("invalid arguments"));
+    maxit = asInteger(CAD8R(args));
+    reltol = asReal(CAD9R(args));
+
+    /* Parameters at the maximum; starting values for now. */
+    PROTECT(sest = allocVector(REALSXP, npar));
+    nprot++;
+    Memcpy(REAL(sest), REAL(spar), npar);
+
+    f.data = &data;
+    f.par = REAL(sest);
+    f.grad = g;
+    f.cached = 0;
+    f.free = (int *) R_alloc(npar, sizeof(int));
+    for (j = 0, nfree = 0; j < npar; j++)
+	if (LOGICAL(sfree)[j] == TRUE)
+	{
+	    if (domain[j] == 'f')
+		error(_("parameter %d cannot be estimated; it must be held fixed"),
+		      j + 1);
+	    f.free[nfree++] = j;
+	}
+    f.nfree = nfree;
+    f.eta = (double *) R_alloc(npar, sizeof(double));
+    eta = (double *) R_alloc(npar, sizeof(double));
+    mask = (int *) R_alloc(npar, sizeof(int));
+
+    for (j = 0; j < nfree; j++)
+    {
+	eta[j] = fitloss_transform(domain[f.free[j]], f.par[f.free[j]]);
+	if (!R_FINITE(eta[j]))
+	    error(_("invalid starting values"));
+	mask[j] = 1;
+    }
+
+    if (!R_FINITE(fitloss_fn(nfree, eta, &f)))
+	error(_("log-likelihood not finite at the starting values"));
+
+    if (nfree > 0)
+	vmmin(nfree, eta, &Fmin, fitloss_fn, fitloss_gr, maxit, 0, mask,
+	      R_NegInf, reltol, 10, (void *) &f, &fncount, &grcount,
+	      &fail);
+    else
+    {
+	Fmin = f.value;
+	fncount = 1;
+	grcount = fail = 0;
+    }
+
+    /* Set the parameters at the optimum found (the last point
+     * evaluated may be another one). */
+    f.cached = 0;
+    fitloss_eval(nfree, eta, &f);
+
+    PROTECT(sinfo = allocMatrix(REALSXP, nfree, nfree));
+    PROTECT(scounts = allocVector(INTSXP, 2));
+    PROTECT(res = allocVector(VECSXP, 5));
+    nprot += 3;
+    fitloss_information(&f, REAL(sinfo));
+    INTEGER(scounts)[0] = fncount;
+    INTEGER(scounts)[1] = grcount;
+
+    SET_VECTOR_ELT(res, 0, sest);
+    SET_VECTOR_ELT(res, 1, ScalarReal(-Fmin));
+    SET_VECTOR_ELT(res, 2, sinfo);
+    SET_VECTOR_ELT(res, 3, scounts);
+    SET_VECTOR_ELT(res, 4, ScalarInteger(fail));
+
+    UNPROTECT(nprot);
+    return res;
+}
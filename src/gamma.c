@@ -78,3 +78,67 @@ double mgfgamma(double t, double shape, double scale, int give_log)
 
     return ACT_D_exp(-shape * log1p(-scale * t));
 }
+
+/*  Prepared distribution (see prepare.c). The density, distribution
+ *  and quantile functions are those of R. For the limited moment,
+ *  c[0] = log(scale), c[1] = gammafn(shape) and, for a given order,
+ *  co[0] = scale^order * gammafn(order + shape), co[1] = order + shape.
+ */
+int prepare_gamma(const double *par, double *c)
+{
+    double shape = par[0], scale = par[1];
+
+    if (!R_FINITE(shape) ||
+        !R_FINITE(scale) ||
+        shape <= 0.0 ||
+        scale <= 0.0)
+        return 0;
+
+    c[0] = log(scale);
+    c[1] = gammafn(shape);
+
+    return 1;
+}
+
+double dgamma_prep(double x, const double *par, const double *c,
+                   int give_log)
+{
+    return dgamma(x, par[0], par[1], give_log);
+}
+
+double pgamma_prep(double q, const double *par, const double *c,
+                   int lower_tail, int log_p)
+{
+    return pgamma(q, par[0], par[1], lower_tail, log_p);
+}
+
+double qgamma_prep(double p, const double *par, const double *c,
+                   int lower_tail, int log_p)
+{
+    return qgamma(p, par[0], par[1], lower_tail, log_p);
+}
+
+void prepare_levgamma(double order, const double *par, const double *c,
+                      double *co)
+{
+    co[1] = order + par[0];
+    co[0] = R_pow(par[1], order) * gammafn(co[1]);
+}
+
+double levgamma_prep(double limit, double order, const double *par,
+                     const double *c, const double *co)
+{
+    if (!R_FINITE(order))
+        return R_NaN;
+
+    if (order <= -par[0])
+	return R_PosInf;
+
+    if (limit <= 0.0)
+        return 0.0;
+
+    double u = exp(log(limit) - c[0]);
+
+    return co[0] * pgamma(u, co[1], 1.0, 1, 0) / c[1] +
+        ACT_DLIM__0(limit, order) * pgamma(u, par[0], 1.0, 0, 0);
+}
@@ -170,3 +170,22 @@ double levgenpareto(double limit, double shape1, double shape2, double scale,
 	/ (gammafn(shape1) * gammafn(shape2))
         + ACT_DLIM__0(limit, order) * pbeta(u, shape2, shape1, 0, 0);
 }
+
+/*  Gradients for the log-likelihood routines (see trbeta.c): the
+ *  generalized Pareto is the transformed beta with shape2 = 1 and
+ *  shape3 = shape2.
+ */
+double dgenpareto_grad(double x, const double *par, double *grad)
+{
+    double g[4], lf = dgenpareto(x, par[0], par[1], par[2], /*give_log*/1);
+
+    if (R_FINITE(lf))
+    {
+	trbeta_dgrad_raw(x, par[0], 1.0, par[1], par[2], 1, g);
+	grad[0] = g[0];
+	grad[1] = g[2];
+	grad[2] = g[3];
+    }
+
+    return lf;
+}
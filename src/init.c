@@ -18,6 +18,17 @@ static const R_ExternalMethodDef ExternalEntries[] = {
     {"actuar_do_dpqphtype", (DL_FUNC) &actuar_do_dpqphtype, -1},
     {"actuar_do_hierarc", (DL_FUNC) &actuar_do_hierarc, -1},
     {"actuar_do_panjer", (DL_FUNC) &actuar_do_panjer, -1},
+    {"actuar_do_panjerbatch", (DL_FUNC) &actuar_do_panjerbatch, -1},
+    {"actuar_do_depril", (DL_FUNC) &actuar_do_depril, -1},
+    {"actuar_do_rcompound", (DL_FUNC) &actuar_do_rcompound, -1},
+    {"actuar_do_rcompoundpar", (DL_FUNC) &actuar_do_rcompoundpar, -1},
+    {"actuar_do_simcompound", (DL_FUNC) &actuar_do_simcompound, -1},
+    {"actuar_do_prepare", (DL_FUNC) &actuar_do_prepare, -1},
+    {"actuar_do_dpqprep", (DL_FUNC) &actuar_do_dpqprep, -1},
+    {"actuar_do_loglik", (DL_FUNC) &actuar_do_loglik, -1},
+    {"actuar_do_fitloss", (DL_FUNC) &actuar_do_fitloss, -1},
+    {"actuar_do_mde", (DL_FUNC) &actuar_do_mde, -1},
+    {"actuar_do_ruinsa", (DL_FUNC) &actuar_do_ruinsa, -1},
     {NULL, NULL, 0}
 };
 
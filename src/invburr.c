@@ -170,3 +170,117 @@ double levinvburr(double limit, double shape1, double shape2, double scale,
 	/ gammafn(shape1)
 	+ ACT_DLIM__0(limit, order) * (0.5 - R_pow(u, shape1) + 0.5);
 }
+
+/*  Batch versions of the density and distribution functions for
+ *  parameters of length one (see dpq.c): the parameters are validated
+ *  and the constants depending on them are computed once for the
+ *  whole vector 'x'. Missing values in 'x' are handled by the caller.
+ */
+void dinvburr_batch(const double *x, double *y, int n, const double *par,
+                    int give_log)
+{
+    int i;
+    double shape1 = par[0], shape2 = par[1], scale = par[2], xi;
+    double lshape, lscale, y0, lx, tmp, logu, log1mu;
+
+    if (!R_FINITE(shape1) ||
+        !R_FINITE(shape2) ||
+        !R_FINITE(scale) ||
+        shape1 <= 0.0 ||
+        shape2 <= 0.0 ||
+        scale <= 0.0)
+    {
+        for (i = 0; i < n; i++)
+            y[i] = R_NaN;
+        return;
+    }
+
+    lshape = log(shape1) + log(shape2);
+    lscale = log(scale);
+    y0 = (shape1 * shape2 < 1) ? R_PosInf : (shape1 * shape2 > 1) ? ACT_D__0 : ACT_D_val(1.0 / scale);
+
+    for (i = 0; i < n; i++)
+    {
+        xi = x[i];
+        if (!R_FINITE(xi) || xi < 0.0)
+            y[i] = ACT_D__0;
+        else if (xi == 0.0)
+            y[i] = y0;
+        else
+        {
+            lx = log(xi);
+            tmp = shape2 * (lx - lscale);
+            logu = - log1pexp(-tmp);
+            log1mu = - log1pexp(tmp);
+            y[i] = ACT_D_exp(lshape + shape1 * logu + log1mu - lx);
+        }
+    }
+}
+
+void pinvburr_batch(const double *x, double *y, int n, const double *par,
+                    int lower_tail, int log_p)
+{
+    int i;
+    double shape1 = par[0], shape2 = par[1], scale = par[2], xi;
+    double lscale, u;
+
+    if (!R_FINITE(shape1) ||
+        !R_FINITE(shape2) ||
+        !R_FINITE(scale) ||
+        shape1 <= 0.0 ||
+        shape2 <= 0.0 ||
+        scale <= 0.0)
+    {
+        for (i = 0; i < n; i++)
+            y[i] = R_NaN;
+        return;
+    }
+
+    lscale = log(scale);
+
+    for (i = 0; i < n; i++)
+    {
+        xi = x[i];
+        if (xi <= 0)
+            y[i] = ACT_DT_0;
+        else
+        {
+            u = exp(-log1pexp(shape2 * (lscale - log(xi))));
+            y[i] = ACT_DT_val(R_pow(u, shape1));
+        }
+    }
+}
+
+/*  Gradients for the log-likelihood routines (see trbeta.c): the
+ *  inverse Burr is the transformed beta with shape1 = 1 and shape3 =
+ *  shape1.
+ */
+double dinvburr_grad(double x, const double *par, double *grad)
+{
+    double g[4], lf = dinvburr(x, par[0], par[1], par[2], /*give_log*/1);
+
+    if (R_FINITE(lf))
+    {
+	trbeta_dgrad_raw(x, 1.0, par[1], par[0], par[2], 0, g);
+	grad[0] = g[2];
+	grad[1] = g[1];
+	grad[2] = g[3];
+    }
+
+    return lf;
+}
+
+double pinvburr_grad(double q, const double *par, double *grad)
+{
+    double g[4], ls = pinvburr(q, par[0], par[1], par[2], /*lower_tail*/0, /*log_p*/1);
+
+    if (R_FINITE(ls))
+    {
+	trbeta_pgrad_raw(q, 1.0, par[1], par[0], par[2], g);
+	grad[0] = g[2];
+	grad[1] = g[1];
+	grad[2] = g[3];
+    }
+
+    return ls;
+}
@@ -118,3 +118,107 @@ double levinvexp(double limit, double scale, double order, int give_log)
     return R_pow(scale, order) * actuar_gamma_inc(1.0 - order, u)
         + ACT_DLIM__0(limit, order) * (0.5 - exp(-u) + 0.5);
 }
+
+/*  Batch versions of the density and distribution functions for
+ *  parameters of length one (see dpq.c): the parameters are validated
+ *  and the constants depending on them are computed once for the
+ *  whole vector 'x'. Missing values in 'x' are handled by the caller.
+ */
+void dinvexp_batch(const double *x, double *y, int n, const double *par,
+                   int give_log)
+{
+    int i;
+    double scale = par[0], xi;
+    double lscale, lx, logu;
+
+    if (!R_FINITE(scale) ||
+        scale <= 0.0)
+    {
+        for (i = 0; i < n; i++)
+            y[i] = R_NaN;
+        return;
+    }
+
+    lscale = log(scale);
+
+    for (i = 0; i < n; i++)
+    {
+        xi = x[i];
+        if (!R_FINITE(xi) || xi <= 0.0)
+            y[i] = ACT_D__0;
+        else
+        {
+            lx = log(xi);
+            logu = lscale - lx;
+            y[i] = ACT_D_exp(logu - exp(logu) - lx);
+        }
+    }
+}
+
+void pinvexp_batch(const double *x, double *y, int n, const double *par,
+                   int lower_tail, int log_p)
+{
+    int i;
+    double scale = par[0], xi;
+    double lscale, u;
+
+    if (!R_FINITE(scale) ||
+        scale <= 0.0)
+    {
+        for (i = 0; i < n; i++)
+            y[i] = R_NaN;
+        return;
+    }
+
+    lscale = log(scale);
+
+    for (i = 0; i < n; i++)
+    {
+        xi = x[i];
+        if (xi <= 0)
+            y[i] = ACT_DT_0;
+        else
+        {
+            u = exp(lscale - log(xi));
+            y[i] = ACT_DT_val(exp(-u));
+        }
+    }
+}
+
+/*  Gradients for the log-likelihood routines (see invtrgamma.c and
+ *  invweibull.c).
+ */
+double dinvexp_grad(double x, const double *par, double *grad)
+{
+    double g[3], lf = dinvexp(x, par[0], /*give_log*/1);
+
+    if (R_FINITE(lf))
+    {
+	invtrgamma_dgrad_raw(x, 1.0, 1.0, par[0], 0, g);
+	grad[0] = g[2];
+    }
+
+    return lf;
+}
+
+double pinvexp_grad(double q, const double *par, double *grad)
+{
+    double scale = par[0];
+    double ls = pinvexp(q, scale, /*lower_tail*/0, /*log_p*/1);
+
+    if (!R_FINITE(ls))
+	return ls;
+
+    /* survival function equal to one */
+    if (q <= 0.0)
+    {
+	grad[0] = 0.0;
+	return ls;
+    }
+
+    double u = scale / q;
+
+    grad[0] = u / expm1(u) / scale;
+
+    return ls;
+}
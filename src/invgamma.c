@@ -161,3 +161,18 @@ double mgfinvgamma(double t, double shape, double scale, int give_log)
 		     log(bessel_k(sqrt(4 * t), shape, 1)) -
 		     lgammafn(shape));
 }
+
+/*  Gradient for the log-likelihood routines (see invtrgamma.c). */
+double dinvgamma_grad(double x, const double *par, double *grad)
+{
+    double g[3], lf = dinvgamma(x, par[0], par[1], /*give_log*/1);
+
+    if (R_FINITE(lf))
+    {
+	invtrgamma_dgrad_raw(x, par[0], 1.0, par[1], 1, g);
+	grad[0] = g[0];
+	grad[1] = g[2];
+    }
+
+    return lf;
+}
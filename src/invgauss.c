@@ -421,3 +421,36 @@ double mgfinvGauss(double x, double nu, double lambda, int give_log)
 
     return ACT_D_exp(lambda / nu * (1.0 - sqrt(1.0 - 2.0 * nu * nu * x/lambda)));
 }
+
+/*  Gradient for the log-likelihood routines (see loglik.c). With
+ *  h = (x - mu)^2/(x * mu^2), the partial derivatives of the
+ *  log-density are
+ *
+ *      mu:  (x - mu)/(phi * mu^3),
+ *      phi: (h/phi - 1)/(2 * phi).
+ *
+ *  In the limiting case mu = Inf, h = 1/x and the derivative with
+ *  respect to mu is zero.
+ */
+double dinvgauss_grad(double x, const double *par, double *grad)
+{
+    double mu = par[0], phi = par[1];
+    double lf = dinvgauss(x, mu, phi, /*give_log*/1);
+
+    if (!R_FINITE(lf))
+	return lf;
+
+    if (!R_FINITE(mu))
+    {
+	grad[0] = 0.0;
+	grad[1] = (1.0/x/phi - 1.0) / (2.0 * phi);
+	return lf;
+    }
+
+    double xm = x/mu, h = R_pow_di(xm - 1, 2) / x;
+
+    grad[0] = (xm - 1) / (phi * mu * mu);
+    grad[1] = (h/phi - 1.0) / (2.0 * phi);
+
+    return lf;
+}
@@ -151,3 +151,36 @@ double levinvtrgamma(double limit, double shape1, double shape2, double scale,
     return R_pow(scale, order) * actuar_gamma_inc(shape1 - order/shape2, u) / gammafn(shape1)
         + ACT_DLIM__0(limit, order) * pgamma(u, shape1, 1.0, 1, 0);
 }
+
+/*  Gradients for the log-likelihood routines (see loglik.c). With
+ *  u = (scale/x)^shape2 and a = shape1 - u, the partial derivatives
+ *  of the log-density are
+ *
+ *      shape1: log(u) - digamma(shape1),
+ *      shape2: 1/shape2 + a * log(scale/x),
+ *      scale:  a * shape2/scale.
+ *
+ *  The inverse gamma (shape2 = 1) and the inverse Weibull (shape1 =
+ *  1) use invtrgamma_dgrad_raw(), which skips the digamma function
+ *  when 'psi' is false.
+ */
+void invtrgamma_dgrad_raw(double x, double shape1, double shape2,
+                          double scale, int psi, double *grad)
+{
+    double ls = log(scale) - log(x), logu = shape2 * ls;
+    double a = shape1 - exp(logu);
+
+    grad[0] = psi ? logu - digamma(shape1) : 0.0;
+    grad[1] = 1.0 / shape2 + a * ls;
+    grad[2] = a * shape2 / scale;
+}
+
+double dinvtrgamma_grad(double x, const double *par, double *grad)
+{
+    double lf = dinvtrgamma(x, par[0], par[1], par[2], /*give_log*/1);
+
+    if (R_FINITE(lf))
+	invtrgamma_dgrad_raw(x, par[0], par[1], par[2], 1, grad);
+
+    return lf;
+}
@@ -137,3 +137,117 @@ double levinvweibull(double limit, double shape, double scale, double order,
     return R_pow(scale, order) * actuar_gamma_inc(1.0 - order/shape, u)
         + ACT_DLIM__0(limit, order) * (0.5 - exp(-u) + 0.5);
 }
+
+/*  Batch versions of the density and distribution functions for
+ *  parameters of length one (see dpq.c): the parameters are validated
+ *  and the constants depending on them are computed once for the
+ *  whole vector 'x'. Missing values in 'x' are handled by the caller.
+ */
+void dinvweibull_batch(const double *x, double *y, int n, const double *par,
+                       int give_log)
+{
+    int i;
+    double shape = par[0], scale = par[1], xi;
+    double lshape, lscale, lx, logu;
+
+    if (!R_FINITE(shape) ||
+        !R_FINITE(scale) ||
+        shape <= 0.0 ||
+        scale <= 0.0)
+    {
+        for (i = 0; i < n; i++)
+            y[i] = R_NaN;
+        return;
+    }
+
+    lshape = log(shape);
+    lscale = log(scale);
+
+    for (i = 0; i < n; i++)
+    {
+        xi = x[i];
+        if (!R_FINITE(xi) || xi <= 0.0)
+            y[i] = ACT_D__0;
+        else
+        {
+            lx = log(xi);
+            logu = shape * (lscale - lx);
+            y[i] = ACT_D_exp(lshape + logu - exp(logu) - lx);
+        }
+    }
+}
+
+void pinvweibull_batch(const double *x, double *y, int n, const double *par,
+                       int lower_tail, int log_p)
+{
+    int i;
+    double shape = par[0], scale = par[1], xi;
+    double lscale, u;
+
+    if (!R_FINITE(shape) ||
+        !R_FINITE(scale) ||
+        shape <= 0.0 ||
+        scale <= 0.0)
+    {
+        for (i = 0; i < n; i++)
+            y[i] = R_NaN;
+        return;
+    }
+
+    lscale = log(scale);
+
+    for (i = 0; i < n; i++)
+    {
+        xi = x[i];
+        if (xi <= 0)
+            y[i] = ACT_DT_0;
+        else
+        {
+            u = exp(shape * (lscale - log(xi)));
+            y[i] = ACT_DT_val(exp(-u));
+        }
+    }
+}
+
+/*  Gradients for the log-likelihood routines (see invtrgamma.c). With
+ *  u = (scale/x)^shape, the log of the survival function is
+ *  log(1 - exp(-u)) and its derivative with respect to u is
+ *  1/(exp(u) - 1).
+ */
+double dinvweibull_grad(double x, const double *par, double *grad)
+{
+    double g[3], lf = dinvweibull(x, par[0], par[1], /*give_log*/1);
+
+    if (R_FINITE(lf))
+    {
+	invtrgamma_dgrad_raw(x, 1.0, par[0], par[1], 0, g);
+	grad[0] = g[1];
+	grad[1] = g[2];
+    }
+
+    return lf;
+}
+
+double pinvweibull_grad(double q, const double *par, double *grad)
+{
+    double shape = par[0], scale = par[1];
+    double ls = pinvweibull(q, shape, scale, /*lower_tail*/0, /*log_p*/1);
+
+    if (!R_FINITE(ls))
+	return ls;
+
+    /* survival function equal to one */
+    if (q <= 0.0)
+    {
+	grad[0] = grad[1] = 0.0;
+	return ls;
+    }
+
+    double lq = log(scale) - log(q), u = exp(shape * lq);
+    double du = u / expm1(u);
+
+    grad[0] = du * lq;
+    grad[1] = du * shape / scale;
+
+    return ls;
+}
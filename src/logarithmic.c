@@ -238,3 +238,18 @@ double rlogarithmic(double p)
 	return(2.0);		       /* case v > q */
     }
 }
+
+/*  Gradient for the log-likelihood routines (see loglik.c). The
+ *  derivative of the log of the probability function with respect to
+ *  p is x/p + 1/((1 - p) log(1 - p)), with limit -1/2 at p = 0.
+ */
+double dlogarithmic_grad(double x, const double *par, double *grad)
+{
+    double p = par[0];
+    double lf = dlogarithmic(x, p, /*give_log*/1);
+
+    if (R_FINITE(lf))
+	grad[0] = (p == 0) ? -0.5 : x/p + 1.0/((1 - p) * log1p(-p));
+
+    return lf;
+}
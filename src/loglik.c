@@ -0,0 +1,449 @@
+/*  ===== actuar: An R Package for Actuarial Science =====
+ *
+ *  Log-likelihood of a sample for the distributions of the package,
+ *  computed in a single pass over the data without storing the
+ *  values of the density. The data is either individual or grouped.
+ *  Censored observations contribute the log of the survival function
+ *  at the censoring point and left truncated observations are
+ *  divided by the survival function at the truncation point. Terms
+ *  are accumulated with Neumaier's variant of compensated (Kahan)
+ *  summation.
+ *
+ *  The gradient of the log-likelihood with respect to the parameters
+ *  is optionally accumulated in the same pass. The gradients of the
+ *  log-density and of the log of the survival function are computed
+ *  in closed form by the *_grad() functions found with the
+ *  distributions, or by central differences for the distributions
+ *  and the parameters without such a function.
+ *
+ *  The distributions and their d*, p* and gradient functions are
+ *  found in table loglik_tab of names.c.
+ *
+ *  AUTHOR: Vincent Goulet <vincent.goulet@act.ulaval.ca>
+ */
+
+#include <R.h>
+#include <Rinternals.h>
+#include <Rmath.h>
+#include "actuar.h"
+#include "locale.h"
+#include "dpq.h"
+
+/* Additional access macros */
+#define CAD5R(e) CAR(CDR(CDR(CDR(CDR(CDR(e))))))
+#define CAD6R(e) CAR(CDR(CDR(CDR(CDR(CDR(CDR(e)))))))
+#define CAD7R(e) CAR(CDR(CDR(CDR(CDR(CDR(CDR(CDR(e))))))))
+
+/* Look up a distribution in the table. */
+loglik_tab_struct *actuar_loglik_lookup(SEXP name)
+{
+    int i;
+    const char *s = CHAR(STRING_ELT(name, 0));
+
+    for (i = 0; loglik_tab[i].name; i++)
+	if (!strcmp(loglik_tab[i].name, s))
+	    return &loglik_tab[i];
+
+    /* No match is an error */
+    error(_("internal error in actuar_do_loglik"));
+
+    return NULL;		/* never used; to keep -Wall happy */
+}
+
+/* Log-density and log-survival function at 'x' of distribution 'd'
+ * with parameters 'p'. */
+static double loglik_d(loglik_tab_struct *d, double x, double *p)
+{
+    switch (d->npar)
+    {
+    case 1:
+	return d->dfun(x, p[0], 1);
+    case 2:
+	return d->dfun(x, p[0], p[1], 1);
+    case 3:
+	return d->dfun(x, p[0], p[1], p[2], 1);
+    case 4:
+	return d->dfun(x, p[0], p[1], p[2], p[3], 1);
+    }
+    return R_NaN;		/* never used; to keep -Wall happy */
+}
+
+static double loglik_s(loglik_tab_struct *d, double x, double *p)
+{
+    switch (d->npar)
+    {
+    case 1:
+	return d->pfun(x, p[0], 0, 1);
+    case 2:
+	return d->pfun(x, p[0], p[1], 0, 1);
+    case 3:
+	return d->pfun(x, p[0], p[1], p[2], 0, 1);
+    case 4:
+	return d->pfun(x, p[0], p[1], p[2], p[3], 0, 1);
+    }
+    return R_NaN;		/* never used; to keep -Wall happy */
+}
+
+/* Step of the central differences used for the derivatives not
+ * available in closed form: DBL_EPSILON^(1/3), relative to the value
+ * of the parameter. */
+#define LOGLIK_NDERIV_EPS 6.0554544523933395e-06
+
+/* Log-density or log-survival function (as computed by 'fun') at 'x'
+ * and its gradient with respect to the parameters, by central
+ * differences. One-sided differences are used next to the boundary
+ * of the parameter space. */
+static double loglik_ngrad(double (*fun)(loglik_tab_struct *, double, double *),
+			   loglik_tab_struct *d, double x, double *par,
+			   double *grad)
+{
+    int j;
+    double l, h, p, lp, lm, tmp[LOGLIK_MAXPAR];
+
+    l = fun(d, x, par);
+    if (!R_FINITE(l))
+	return l;
+
+    Memcpy(tmp, par, d->npar);
+    for (j = 0; j < d->npar; j++)
+    {
+	p = par[j];
+	h = LOGLIK_NDERIV_EPS * (fabs(p) + LOGLIK_NDERIV_EPS);
+	h = (p + h) - p;	/* exactly representable step */
+	tmp[j] = p + h;
+	lp = fun(d, x, tmp);
+	tmp[j] = p - h;
+	lm = fun(d, x, tmp);
+	tmp[j] = p;
+
+	if (R_FINITE(lp) && R_FINITE(lm))
+	    grad[j] = (lp - lm) / (2.0 * h);
+	else if (R_FINITE(lp))
+	    grad[j] = (lp - l) / h;
+	else if (R_FINITE(lm))
+	    grad[j] = (l - lm) / h;
+	else
+	    grad[j] = R_NaN;
+    }
+
+    return l;
+}
+
+/* Log-density and log-survival function with their gradients:
+ * analytic when the distribution provides them, numerical otherwise. */
+static double loglik_dg(loglik_tab_struct *d, double x, double *par,
+			double *grad)
+{
+    return d->dgrad ?
+	d->dgrad(x, par, grad) :
+	loglik_ngrad(loglik_d, d, x, par, grad);
+}
+
+static double loglik_sg(loglik_tab_struct *d, double x, double *par,
+			double *grad)
+{
+    return d->pgrad ?
+	d->pgrad(x, par, grad) :
+	loglik_ngrad(loglik_s, d, x, par, grad);
+}
+
+/* Compensated summation: add 'v' to the sum 's' with running
+ * compensation 'c'. The result is s + c. */
+#define SUM_ADD(s, c, v)			\
+    {						\
+	double t_ = (s) + (v);			\
+	if (fabs(s) >= fabs(v))			\
+	    (c) += ((s) - t_) + (v);		\
+	else					\
+	    (c) += ((v) - t_) + (s);		\
+	(s) = t_;				\
+    }
+
+/* Log-likelihood of individual data. */
+static double loglik_individual(loglik_data_struct *data, double *par,
+				double *grad)
+{
+    loglik_tab_struct *d = data->d;
+    int i, j, n = data->n, npar = d->npar, *cens = data->cens;
+    double *x = data->x, *w = data->w, *trunc = NULL;
+    double wi, l, lt = 0.0, sum = 0.0, comp = 0.0, nonfinite = 0.0;
+    double gi[LOGLIK_MAXPAR], gt[LOGLIK_MAXPAR], glt[LOGLIK_MAXPAR],
+	gcomp[LOGLIK_MAXPAR];
+
+    for (j = 0; j < npar; j++)
+    {
+	glt[j] = gcomp[j] = 0.0;
+	if (grad)
+	    grad[j] = 0.0;
+    }
+
+    if (data->ntrunc == 1)
+	lt = grad ?
+	    loglik_sg(d, data->trunc[0], par, glt) :
+	    loglik_s(d, data->trunc[0], par);
+    else if (data->ntrunc > 1)
+	trunc = data->trunc;
+
+    for (i = 0; i < n; i++)
+    {
+	wi = w ? w[i] : 1.0;
+	if (wi == 0.0)
+	    continue;
+	if (ISNA(x[i]) || ISNA(wi) || (cens && cens[i] == NA_LOGICAL))
+	    return NA_REAL;
+
+	if (!grad)
+	{
+	    l = (cens && cens[i]) ? loglik_s(d, x[i], par) : loglik_d(d, x[i], par);
+	    l -= trunc ? loglik_s(d, trunc[i], par) : lt;
+	}
+	else
+	{
+	    l = (cens && cens[i]) ?
+		loglik_sg(d, x[i], par, gi) :
+		loglik_dg(d, x[i], par, gi);
+	    if (trunc)
+	    {
+		l -= loglik_sg(d, trunc[i], par, gt);
+		for (j = 0; j < npar; j++)
+		    gi[j] -= gt[j];
+	    }
+	    else
+	    {
+		l -= lt;
+		for (j = 0; j < npar; j++)
+		    gi[j] -= glt[j];
+	    }
+	}
+
+	/* Infinite and NaN terms are kept apart from the sum; the
+	 * gradient is then not defined. */
+	if (R_FINITE(l))
+	{
+	    SUM_ADD(sum, comp, wi * l)
+	    if (grad)
+		for (j = 0; j < npar; j++)
+		    SUM_ADD(grad[j], gcomp[j], wi * gi[j])
+	}
+	else
+	    nonfinite += wi * l;
+    }
+
+    if (nonfinite != 0.0)
+    {
+	if (grad)
+	    for (j = 0; j < npar; j++)
+		grad[j] = R_NaN;
+	return nonfinite;
+    }
+    if (grad)
+	for (j = 0; j < npar; j++)
+	    grad[j] += gcomp[j];
+    return sum + comp;
+}
+
+/* Log-likelihood of grouped data: the contribution of a group with
+ * boundaries a < b is log[S(a) - S(b)], computed from the logs of the
+ * survival function as log S(a) + log(1 - S(b)/S(a)). The derivative
+ * with respect to a parameter is, with r = S(b)/S(a) and g() the
+ * derivative of log S(),
+ *
+ *     [g(a) - r g(b)]/(1 - r).
+ *
+ * Truncation applies to all the data. */
+static double loglik_grouped(loglik_data_struct *data, double *par,
+			     double *grad)
+{
+    loglik_tab_struct *d = data->d;
+    int i, j, n = data->n, npar = d->npar;
+    double *cj = data->x, *nj = data->w;
+    double wi, l, r, lsa, lsb, ntot = 0.0, sum = 0.0, comp = 0.0,
+	nonfinite = 0.0;
+    double ga[LOGLIK_MAXPAR], gb[LOGLIK_MAXPAR], gcomp[LOGLIK_MAXPAR];
+
+    for (j = 0; j < npar; j++)
+    {
+	gcomp[j] = 0.0;
+	if (grad)
+	    grad[j] = 0.0;
+    }
+
+    lsa = grad ? loglik_sg(d, cj[0], par, ga) : loglik_s(d, cj[0], par);
+    for (i = 0; i < n; i++)
+    {
+	lsb = grad ?
+	    loglik_sg(d, cj[i + 1], par, gb) :
+	    loglik_s(d, cj[i + 1], par);
+
+	wi = nj[i];
+	if (ISNA(wi) || ISNA(cj[i + 1]))
+	    return NA_REAL;
+	if (wi != 0.0)
+	{
+	    ntot += wi;
+	    l = lsa + ACT_Log1_Exp(lsb - lsa);
+	    if (R_FINITE(l))
+	    {
+		SUM_ADD(sum, comp, wi * l)
+		if (grad)
+		{
+		    /* S(b) = 0 in the last group */
+		    r = (lsb == R_NegInf) ? 0.0 : exp(lsb - lsa);
+		    for (j = 0; j < npar; j++)
+			SUM_ADD(grad[j], gcomp[j],
+				wi * ((r == 0.0) ? ga[j] :
+				      (ga[j] - r * gb[j]) / (1.0 - r)))
+		}
+	    }
+	    else
+		nonfinite += wi * l;
+	}
+
+	lsa = lsb;
+	if (grad)
+	    Memcpy(ga, gb, npar);
+    }
+
+    if (nonfinite != 0.0)
+    {
+	if (grad)
+	    for (j = 0; j < npar; j++)
+		grad[j] = R_NaN;
+	return nonfinite;
+    }
+
+    if (data->ntrunc)
+    {
+	l = grad ?
+	    loglik_sg(d, data->trunc[0], par, ga) :
+	    loglik_s(d, data->trunc[0], par);
+	SUM_ADD(sum, comp, -ntot * l)
+	if (grad)
+	    for (j = 0; j < npar; j++)
+		SUM_ADD(grad[j], gcomp[j], -ntot * ga[j])
+    }
+
+    if (grad)
+	for (j = 0; j < npar; j++)
+	    grad[j] += gcomp[j];
+    return sum + comp;
+}
+
+/* Log-likelihood of the data for parameters 'par' and, when 'grad'
+ * is not NULL, its gradient with respect to the parameters. The
+ * value is NA when the data contain missing values (with a nonzero
+ * weight) and the gradient is NaN when the value is not finite. */
+double actuar_loglik(loglik_data_struct *data, double *par, double *grad)
+{
+    int j;
+    double l = data->grouped ?
+	loglik_grouped(data, par, grad) :
+	loglik_individual(data, par, grad);
+
+    if (grad && ISNA(l))
+	for (j = 0; j < data->d->npar; j++)
+	    grad[j] = NA_REAL;
+
+    return l;
+}
+
+/* Set up the data for actuar_loglik() from the first elements of
+ * 'args': name of the distribution; observations or group
+ * boundaries; weights or group frequencies (or NULL); logical vector
+ * of censoring indicators (or NULL); truncation points, of length
+ * one or of the length of the observations (or NULL); logical,
+ * whether the data is grouped. Returns the number of objects
+ * protected. */
+int actuar_loglik_data(SEXP args, loglik_data_struct *data)
+{
+    SEXP sx, sw, sc, st;
+    int n, nprot = 1;
+
+    data->d = actuar_loglik_lookup(CAR(args));
+    data->grouped = asLogical(CAD5R(args)) == TRUE;
+
+    PROTECT(sx = coerceVector(CADR(args), REALSXP));
+    data->x = REAL(sx);
+    n = data->n = LENGTH(sx) - data->grouped;
+
+    data->w = NULL;
+    sw = CADDR(args);
+    if (!isNull(sw))
+    {
+	if (LENGTH(sw) != n)
+	    error(_("invalid arguments"));
+	PROTECT(sw = coerceVector(sw, REALSXP));
+	nprot++;
+	data->w = REAL(sw);
+    }
+    else if (data->grouped)
+	error(_("invalid arguments"));
+
+    data->cens = NULL;
+    sc = CADDDR(args);
+    if (!isNull(sc))
+    {
+	if (LENGTH(sc) != n || data->grouped)
+	    error(_("invalid arguments"));
+	PROTECT(sc = coerceVector(sc, LGLSXP));
+	nprot++;
+	data->cens = LOGICAL(sc);
+    }
+
+    data->trunc = NULL;
+    data->ntrunc = 0;
+    st = CAD4R(args);
+    if (!isNull(st))
+    {
+	data->ntrunc = LENGTH(st);
+	if (data->ntrunc != 1 && (data->ntrunc != n || data->grouped))
+	    error(_("invalid arguments"));
+	PROTECT(st = coerceVector(st, REALSXP));
+	nprot++;
+	data->trunc = REAL(st);
+    }
+
+    return nprot;
+}
+
+/* Arguments of .External(): the data as described in
+ * actuar_loglik_data(); parameters; logical, whether to compute the
+ * gradient with respect to the parameters.
+ *
+ * The gradient is returned in attribute "gradient" of the result. It
+ * is accumulated in the same pass over the data as the
+ * log-likelihood. */
+SEXP actuar_do_loglik(SEXP args)
+{
+    SEXP spar, ans, sgrad;
+    loglik_data_struct data;
+    int nprot, dograd;
+    double l;
+
+    args = CDR(args);
+    nprot = actuar_loglik_data(args, &data);
+
+    PROTECT(spar = coerceVector(CAD6R(args), REALSXP));
+    nprot++;
+    if (LENGTH(spar) != data.d->npar)
+	error(_("invalid arguments"));
+    dograd = asLogical(CAD7R(args)) == TRUE;
+
+    if (dograd)
+    {
+	PROTECT(sgrad = allocVector(REALSXP, data.d->npar));
+	nprot++;
+	l = actuar_loglik(&data, REAL(spar), REAL(sgrad));
+	PROTECT(ans = ScalarReal(l));
+	nprot++;
+	setAttrib(ans, install("gradient"), sgrad);
+    }
+    else
+    {
+	PROTECT(ans = ScalarReal(actuar_loglik(&data, REAL(spar), NULL)));
+	nprot++;
+    }
+
+    UNPROTECT(nprot);
+    return ans;
+}
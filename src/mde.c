@@ -0,0 +1,233 @@
+/*  ===== actuar: An R Package for Actuarial Science =====
+ *
+ *  Objective functions of minimum distance estimation for the
+ *  distributions of the package, with their gradients with respect
+ *  to the parameters. Three measures are supported:
+ *
+ *  1. Cramer-von Mises: sum of w[i] (F(x[i]) - Fn(x[i]))^2;
+ *  2. modified chi-square: sum of w[j] (n (F(c[j]) - F(c[j-1])) - n[j])^2;
+ *  3. layer average severity: sum of w[j] (LAS(c[j-1], c[j]) - LASn[j])^2
+ *     where LAS(a, b) = E[X ^ b] - E[X ^ a].
+ *
+ *  The empirical values Fn(x[i]), n[j] and LASn[j] do not depend on
+ *  the parameters and are computed once in R. The gradient of F is
+ *  obtained from the gradient of the log of the survival function
+ *  when the distribution provides it in closed form; all other
+ *  derivatives are computed by central differences.
+ *
+ *  The distributions are those of table loglik_tab in names.c.
+ *
+ *  See ../R/mde.R for details.
+ *
+ *  AUTHOR: Vincent Goulet <vincent.goulet@act.ulaval.ca>
+ */
+
+#include <R.h>
+#include <Rinternals.h>
+#include <Rmath.h>
+#include "actuar.h"
+#include "locale.h"
+
+/* Additional access macros */
+#define CAD5R(e) CAR(CDR(CDR(CDR(CDR(CDR(e))))))
+#define CAD6R(e) CAR(CDR(CDR(CDR(CDR(CDR(CDR(e)))))))
+#define CAD7R(e) CAR(CDR(CDR(CDR(CDR(CDR(CDR(CDR(e))))))))
+#define CAD8R(e) CAR(CDR(CDR(CDR(CDR(CDR(CDR(CDR(CDR(e)))))))))
+
+/* Codes of the measures; same order as in mde(). */
+#define MDE_CVM 1
+#define MDE_CHISQ 2
+#define MDE_LAS 3
+
+/* Step of the central differences: DBL_EPSILON^(1/3), relative to
+ * the value of the parameter. */
+#define MDE_NDERIV_EPS 6.0554544523933395e-06
+
+/* Cumulative distribution function or limited expected value of
+ * order 'order' at 'x'. */
+static double mde_value(loglik_tab_struct *d, int measure, double x,
+			double *p, double order)
+{
+    if (measure == MDE_LAS)
+    {
+	switch (d->npar)
+	{
+	case 1:
+	    return d->levfun(x, p[0], order, 0);
+	case 2:
+	    return d->levfun(x, p[0], p[1], order, 0);
+	case 3:
+	    return d->levfun(x, p[0], p[1], p[2], order, 0);
+	case 4:
+	    return d->levfun(x, p[0], p[1], p[2], p[3], order, 0);
+	}
+    }
+    else
+    {
+	switch (d->npar)
+	{
+	case 1:
+	    return d->pfun(x, p[0], 1, 0);
+	case 2:
+	    return d->pfun(x, p[0], p[1], 1, 0);
+	case 3:
+	    return d->pfun(x, p[0], p[1], p[2], 1, 0);
+	case 4:
+	    return d->pfun(x, p[0], p[1], p[2], p[3], 1, 0);
+	}
+    }
+    return R_NaN;		/* never used; to keep -Wall happy */
+}
+
+/* Values of the model at the 'm' knots in 'v' and, when 'dv' is not
+ * NULL, their derivatives with respect to the parameters in the
+ * columns of the m x npar matrix 'dv'. */
+static void mde_values(loglik_tab_struct *d, int measure, double *x,
+		       int m, double *par, double order, double *v,
+		       double *dv)
+{
+    int i, j, npar = d->npar;
+    double p, h, ls, s, g[LOGLIK_MAXPAR], tmp[LOGLIK_MAXPAR], *vp, *vm;
+
+    /* F(x) = 1 - S(x) and dF/dpar = -S(x) dlog S(x)/dpar. */
+    if (dv && measure != MDE_LAS && d->pgrad)
+    {
+	for (i = 0; i < m; i++)
+	{
+	    ls = d->pgrad(x[i], par, g);
+	    if (R_FINITE(ls))
+	    {
+		s = exp(ls);
+		v[i] = -expm1(ls);
+		for (j = 0; j < npar; j++)
+		    dv[i + j * m] = -s * g[j];
+	    }
+	    else
+	    {
+		v[i] = (ls == R_NegInf) ? 1.0 : R_NaN;
+		for (j = 0; j < npar; j++)
+		    dv[i + j * m] = 0.0;
+	    }
+	}
+	return;
+    }
+
+    for (i = 0; i < m; i++)
+	v[i] = mde_value(d, measure, x[i], par, order);
+
+    if (!dv)
+	return;
+
+    vp = (double *) R_alloc(m, sizeof(double));
+    vm = (double *) R_alloc(m, sizeof(double));
+    Memcpy(tmp, par, npar);
+    for (j = 0; j < npar; j++)
+    {
+	p = par[j];
+	h = MDE_NDERIV_EPS * (fabs(p) + MDE_NDERIV_EPS);
+	h = (p + h) - p;	/* exactly representable step */
+	tmp[j] = p + h;
+	for (i = 0; i < m; i++)
+	    vp[i] = mde_value(d, measure, x[i], tmp, order);
+	tmp[j] = p - h;
+	for (i = 0; i < m; i++)
+	    vm[i] = mde_value(d, measure, x[i], tmp, order);
+	tmp[j] = p;
+
+	for (i = 0; i < m; i++)
+	{
+	    if (R_FINITE(vp[i]) && R_FINITE(vm[i]))
+		dv[i + j * m] = (vp[i] - vm[i]) / (2.0 * h);
+	    else if (R_FINITE(vp[i]))
+		dv[i + j * m] = (vp[i] - v[i]) / h;
+	    else if (R_FINITE(vm[i]))
+		dv[i + j * m] = (v[i] - vm[i]) / h;
+	    else
+		dv[i + j * m] = R_NaN;
+	}
+    }
+}
+
+/* Arguments of .External(): name of the distribution; code of the
+ * measure; knots; empirical values; weights (recycled); multiplier
+ * of the differences of the model values (the number of observations
+ * for the chi-square measure, 1 otherwise); parameters; order of
+ * the limited moment; logical, whether to compute the gradient.
+ *
+ * The gradient with respect to the parameters is returned in
+ * attribute "gradient" of the value of the objective function. */
+SEXP actuar_do_mde(SEXP args)
+{
+    SEXP sx, st, sw, spar, ans, sgrad;
+    loglik_tab_struct *d;
+    int i, j, m, nr, nw, npar, measure, dograd, nprot = 5;
+    double r, wi, scale, order, sum = 0.0, *x, *t, *w, *par, *v, *dv,
+	*grad = NULL;
+
+    args = CDR(args);
+    d = actuar_loglik_lookup(CAR(args));
+    measure = asInteger(CADR(args));
+    PROTECT(sx = coerceVector(CADDR(args), REALSXP));
+    PROTECT(st = coerceVector(CADDDR(args), REALSXP));
+    PROTECT(sw = coerceVector(CAD4R(args), REALSXP));
+    scale = asReal(CAD5R(args));
+    PROTECT(spar = coerceVector(CAD6R(args), REALSXP));
+    order = asReal(CAD7R(args));
+    dograd = asLogical(CAD8R(args)) == TRUE;
+
+    npar = d->npar;
+    m = LENGTH(sx);
+    nr = (measure == MDE_CVM) ? m : m - 1; /* number of residuals */
+    nw = LENGTH(sw);
+    if (LENGTH(spar) != npar || LENGTH(st) != nr || nw == 0 ||
+	(measure == MDE_LAS && !d->levfun))
+	error(_("invalid arguments"));
+
+    x = REAL(sx);
+    t = REAL(st);
+    w = REAL(sw);
+    par = REAL(spar);
+
+    v = (double *) R_alloc(m, sizeof(double));
+    dv = dograd ? (double *) R_alloc(m * npar, sizeof(double)) : NULL;
+    mde_values(d, measure, x, m, par, order, v, dv);
+
+    PROTECT(ans = allocVector(REALSXP, 1));
+    if (dograd)
+    {
+	PROTECT(sgrad = allocVector(REALSXP, npar));
+	nprot++;
+	grad = REAL(sgrad);
+	for (j = 0; j < npar; j++)
+	    grad[j] = 0.0;
+    }
+
+    for (i = 0; i < nr; i++)
+    {
+	wi = w[i % nw];
+	if (measure == MDE_CVM)
+	{
+	    r = v[i] - t[i];
+	    sum += wi * r * r;
+	    if (dograd)
+		for (j = 0; j < npar; j++)
+		    grad[j] += 2.0 * wi * r * dv[i + j * m];
+	}
+	else
+	{
+	    r = scale * (v[i + 1] - v[i]) - t[i];
+	    sum += wi * r * r;
+	    if (dograd)
+		for (j = 0; j < npar; j++)
+		    grad[j] += 2.0 * wi * r * scale *
+			(dv[i + 1 + j * m] - dv[i + j * m]);
+	}
+    }
+
+    REAL(ans)[0] = sum;
+    if (dograd)
+	setAttrib(ans, install("gradient"), sgrad);
+
+    UNPROTECT(nprot);
+    return ans;
+}
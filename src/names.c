@@ -11,6 +11,7 @@
  */
 
 #include <Rinternals.h>
+#include <Rmath.h>
 #include "actuar.h"
 
 /* DENSITY, CUMULATIVE PROBABILITY AND QUANTILE FUNCTIONS,
@@ -224,3 +225,149 @@ random_tab_struct random_tab[] = {
     {"rphtype",         actuar_do_randomphtype2, 1, REALSXP},
     {0, 0, 0}
 };
+
+/* DISTRIBUTIONS FOR COMPOUND MODELS SIMULATION (compound.c)
+ * Functions from base R first, then the ones of the package. The
+ * parameters are those of the C functions, in the same order. The
+ * quantile function is used for simulation by inversion in parallel
+ * (0 when not available). */
+compound_tab_struct compound_tab[] = {
+    /* Base R distributions */
+    {"rpois",           1, rpois,           qpois,           INTSXP},
+    {"rgeom",           1, rgeom,           qgeom,           INTSXP},
+    {"rexp",            1, rexp,            qexp,            REALSXP},
+    {"rbinom",          2, rbinom,          qbinom,          INTSXP},
+    {"rnbinom",         2, rnbinom,         qnbinom,         INTSXP},
+    {"rgamma",          2, rgamma,          qgamma,          REALSXP},
+    {"rlnorm",          2, rlnorm,          qlnorm,          REALSXP},
+    {"rweibull",        2, rweibull,        qweibull,        REALSXP},
+    {"rbeta",           2, rbeta,           qbeta,           REALSXP},
+    {"rnorm",           2, rnorm,           qnorm,           REALSXP},
+    {"runif",           2, runif,           qunif,           REALSXP},
+    /* One parameter distributions */
+    {"rinvexp",         1, rinvexp,         qinvexp,         REALSXP},
+    {"rlogarithmic",    1, rlogarithmic,    qlogarithmic,    INTSXP},
+    {"rztpois",         1, rztpois,         qztpois,         INTSXP},
+    {"rztgeom",         1, rztgeom,         qztgeom,         INTSXP},
+    /* Two parameter distributions */
+    {"rinvgamma",       2, rinvgamma,       qinvgamma,       REALSXP},
+    {"rinvparalogis",   2, rinvparalogis,   qinvparalogis,   REALSXP},
+    {"rinvpareto",      2, rinvpareto,      qinvpareto,      REALSXP},
+    {"rinvweibull",     2, rinvweibull,     qinvweibull,     REALSXP},
+    {"rlgamma",         2, rlgamma,         qlgamma,         REALSXP},
+    {"rllogis",         2, rllogis,         qllogis,         REALSXP},
+    {"rparalogis",      2, rparalogis,      qparalogis,      REALSXP},
+    {"rpareto",         2, rpareto,         qpareto,         REALSXP},
+    {"rpareto1",        2, rpareto1,        qpareto1,        REALSXP},
+    {"rgumbel",         2, rgumbel,         qgumbel,         REALSXP},
+    {"rinvgauss",       2, rinvgauss,       0,               REALSXP},
+    {"rztnbinom",       2, rztnbinom,       qztnbinom,       INTSXP},
+    {"rztbinom",        2, rztbinom,        qztbinom,        INTSXP},
+    {"rzmlogarithmic",  2, rzmlogarithmic,  qzmlogarithmic,  INTSXP},
+    {"rzmpois",         2, rzmpois,         qzmpois,         INTSXP},
+    {"rzmgeom",         2, rzmgeom,         qzmgeom,         INTSXP},
+    {"rpoisinvgauss",   2, rpoisinvgauss,   qpoisinvgauss,   INTSXP},
+    /* Three parameter distributions */
+    {"rburr",           3, rburr,           qburr,           REALSXP},
+    {"rgenpareto",      3, rgenpareto,      qgenpareto,      REALSXP},
+    {"rinvburr",        3, rinvburr,        qinvburr,        REALSXP},
+    {"rinvtrgamma",     3, rinvtrgamma,     qinvtrgamma,     REALSXP},
+    {"rtrgamma",        3, rtrgamma,        qtrgamma,        REALSXP},
+    {"rzmnbinom",       3, rzmnbinom,       qzmnbinom,       INTSXP},
+    {"rzmbinom",        3, rzmbinom,        qzmbinom,        INTSXP},
+    /* Four parameter distributions */
+    {"rtrbeta",         4, rtrbeta,         qtrbeta,         REALSXP},
+    {"rgenbeta",        4, rgenbeta,        qgenbeta,        REALSXP},
+    {0, 0, 0, 0, 0}
+};
+
+/* PREPARED DISTRIBUTIONS (prepare.c)
+ * Number of parameters and of constants, function validating the
+ * parameters and computing the constants, then the {d,p,q}
+ * functions and the functions for the limited moments (0 when not
+ * available). */
+prepared_tab_struct prepared_tab[] = {
+    {"gamma",        2, 2, prepare_gamma,
+     dgamma_prep, pgamma_prep, qgamma_prep,
+     prepare_levgamma, levgamma_prep},
+    {"poisinvgauss", 2, 3, prepare_poisinvgauss,
+     dpoisinvgauss_prep, ppoisinvgauss_prep, qpoisinvgauss_prep,
+     0, 0},
+    {"trbeta",       4, 5, prepare_trbeta,
+     dtrbeta_prep, ptrbeta_prep, qtrbeta_prep,
+     prepare_levtrbeta, levtrbeta_prep},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0}
+};
+
+/* Distributions known to loglik(), fitloss() and the native
+ * objectives of mde(): number of parameters, domain of the parameters
+ * (see actuar.h), density and distribution functions, gradients of
+ * the log-density and of the log of the survival function, limited
+ * expected value function. */
+loglik_tab_struct loglik_tab[] = {
+    /* One parameter distributions */
+    {"invexp",        1, "p",   dinvexp,         pinvexp,
+     dinvexp_grad,          pinvexp_grad,          levinvexp},
+    {"logarithmic",   1, "u",   dlogarithmic,    plogarithmic,
+     dlogarithmic_grad,     0,                     0},
+    {"ztpois",        1, "p",   dztpois,         pztpois,
+     dztpois_grad,          pztpois_grad,          0},
+    {"ztgeom",        1, "u",   dztgeom,         pztgeom,
+     dztgeom_grad,          pztgeom_grad,          0},
+    /* Two parameter distributions */
+    {"gumbel",        2, "rp",  dgumbel,         pgumbel,
+     0,                     0,                     0},
+    {"invgamma",      2, "pp",  dinvgamma,       pinvgamma,
+     dinvgamma_grad,        0,                     levinvgamma},
+    {"invgauss",      2, "pp",  dinvgauss,       pinvgauss,
+     dinvgauss_grad,        0,                     levinvgauss},
+    {"invparalogis",  2, "pp",  dinvparalogis,   pinvparalogis,
+     dinvparalogis_grad,    pinvparalogis_grad,    levinvparalogis},
+    {"invpareto",     2, "pp",  dinvpareto,      pinvpareto,
+     dinvpareto_grad,       pinvpareto_grad,       levinvpareto},
+    {"invweibull",    2, "pp",  dinvweibull,     pinvweibull,
+     dinvweibull_grad,      pinvweibull_grad,      levinvweibull},
+    {"lgamma",        2, "pp",  dlgamma,         plgamma,
+     0,                     0,                     levlgamma},
+    {"llogis",        2, "pp",  dllogis,         pllogis,
+     dllogis_grad,          pllogis_grad,          levllogis},
+    {"paralogis",     2, "pp",  dparalogis,      pparalogis,
+     dparalogis_grad,       pparalogis_grad,       levparalogis},
+    {"pareto",        2, "pp",  dpareto,         ppareto,
+     dpareto_grad,          ppareto_grad,          levpareto},
+    {"pareto1",       2, "pf",  dpareto1,        ppareto1,
+     dpareto1_grad,         ppareto1_grad,         levpareto1},
+    {"poisinvgauss",  2, "pp",  dpoisinvgauss,   ppoisinvgauss,
+     0,                     0,                     0},
+    {"zmgeom",        2, "uu",  dzmgeom,         pzmgeom,
+     dzmgeom_grad,          pzmgeom_grad,          0},
+    {"zmlogarithmic", 2, "uu",  dzmlogarithmic,  pzmlogarithmic,
+     dzmlogarithmic_grad,   0,                     0},
+    {"zmpois",        2, "pu",  dzmpois,         pzmpois,
+     dzmpois_grad,          pzmpois_grad,          0},
+    {"ztbinom",       2, "fu",  dztbinom,        pztbinom,
+     dztbinom_grad,         pztbinom_grad,         0},
+    {"ztnbinom",      2, "pu",  dztnbinom,       pztnbinom,
+     dztnbinom_grad,        0,                     0},
+    /* Three parameter distributions */
+    {"burr",          3, "ppp", dburr,           pburr,
+     dburr_grad,            pburr_grad,            levburr},
+    {"genpareto",     3, "ppp", dgenpareto,      pgenpareto,
+     dgenpareto_grad,       0,                     levgenpareto},
+    {"invburr",       3, "ppp", dinvburr,        pinvburr,
+     dinvburr_grad,         pinvburr_grad,         levinvburr},
+    {"invtrgamma",    3, "ppp", dinvtrgamma,     pinvtrgamma,
+     dinvtrgamma_grad,      0,                     levinvtrgamma},
+    {"trgamma",       3, "ppp", dtrgamma,        ptrgamma,
+     dtrgamma_grad,         0,                     levtrgamma},
+    {"zmbinom",       3, "fuu", dzmbinom,        pzmbinom,
+     dzmbinom_grad,         pzmbinom_grad,         0},
+    {"zmnbinom",      3, "puu", dzmnbinom,       pzmnbinom,
+     dzmnbinom_grad,        0,                     0},
+    /* Four parameter distributions */
+    {"genbeta",       4, "pppp", dgenbeta,       pgenbeta,
+     0,                     0,                     levgenbeta},
+    {"trbeta",        4, "pppp", dtrbeta,        ptrbeta,
+     dtrbeta_grad,          0,                     levtrbeta},
+    {0, 0, 0, 0, 0, 0, 0, 0}
+};
@@ -2,7 +2,8 @@
  *
  *  Function to compute the recursive part of the Panjer formula
  *  to approximate the aggregate claim amount distribution of
- *  a portfolio over a period.
+ *  a portfolio over a period. Also the De Pril recursion for the
+ *  distribution of the individual risk model.
  *
  *  AUTHORS: Tommy Ouellet, Vincent Goulet <vincent.goulet@act.ulaval.ca>
  */
@@ -10,6 +11,7 @@
 #include <R.h>
 #include <Rmath.h>
 #include <Rinternals.h>
+#include <R_ext/Applic.h>
 #include "locale.h"
 
 #define CAD5R(e)  CAR(CDR(CDR(CDR(CDR(CDR(e))))))
@@ -18,16 +20,128 @@
 #define CAD8R(e)  CAR(CDR(CDR(CDR(CDR(CDR(CDR(CDR(CDR(e)))))))))
 #define CAD9R(e)  CAR(CDR(CDR(CDR(CDR(CDR(CDR(CDR(CDR(CDR(e))))))))))
 #define CAD10R(e) CAR(CDR(CDR(CDR(CDR(CDR(CDR(CDR(CDR(CDR(CDR(e)))))))))))
+#define CAD11R(e) CAR(CDR(CDR(CDR(CDR(CDR(CDR(CDR(CDR(CDR(CDR(CDR(e))))))))))))
 
 #define INITSIZE 100		/* default size for prob. vector */
+#define SPARSE_RATIO 8		/* see actuar_do_panjer */
+#define SCALE_MAX 1e150		/* see panjer_rescale */
+
+/*  Smallest integer not less than n with no prime factor other than
+ *  2, 3 or 5 (as nextn() in R). The FFT is efficient for such
+ *  lengths. */
+static int nextn235(int n)
+{
+    int m;
+
+    for (;; n++)
+    {
+	m = n;
+	while (m % 2 == 0) m /= 2;
+	while (m % 3 == 0) m /= 3;
+	while (m % 5 == 0) m /= 5;
+	if (m == 1)
+	    return n;
+    }
+}
+
+/*  Sum of the recursive part of the Panjer formula
+ *
+ *    sum_{k = 1}^m (a + b * k/x) * fx[k] * fs[x - k]
+ *
+ *  computed as two dot products of the reversed vector 'fs' with
+ *  vectors afx[k] = a * fx[k] and bfx[k] = b * k * fx[k] computed
+ *  once for all recursions. The loop is blocked in groups of four
+ *  with independent partial sums to break the dependency chain of
+ *  the accumulators and let the compiler use SIMD instructions. */
+static double panjer_sum(double *afx, double *bfx, double *fs, int x, int m)
+{
+    int k;
+    double *f = fs + x;         /* f[-k] == fs[x - k] */
+    double sa0 = 0.0, sa1 = 0.0, sa2 = 0.0, sa3 = 0.0;
+    double sb0 = 0.0, sb1 = 0.0, sb2 = 0.0, sb3 = 0.0;
+
+    for (k = 1; k + 3 <= m; k += 4)
+    {
+	sa0 += afx[k]     * f[-k];
+	sa1 += afx[k + 1] * f[-k - 1];
+	sa2 += afx[k + 2] * f[-k - 2];
+	sa3 += afx[k + 3] * f[-k - 3];
+	sb0 += bfx[k]     * f[-k];
+	sb1 += bfx[k + 1] * f[-k - 1];
+	sb2 += bfx[k + 2] * f[-k - 2];
+	sb3 += bfx[k + 3] * f[-k - 3];
+    }
+    for (; k <= m; k++)
+    {
+	sa0 += afx[k] * f[-k];
+	sb0 += bfx[k] * f[-k];
+    }
+
+    return ((sa0 + sa1) + (sa2 + sa3)) + ((sb0 + sb1) + (sb2 + sb3)) / x;
+}
+
+/*  Same as panjer_sum() for a sparse severity distribution stored as
+ *  (index, probability) pairs: idx[i] are the nk values of k with
+ *  fx[k] > 0 and 1 <= k <= min(x, upper), in increasing order, and
+ *  afx[i], bfx[i] the matching values of a * fx[k] and b * k *
+ *  fx[k]. The cost is O(nk) instead of O(min(x, upper)). */
+static double panjer_sum_sparse(int *idx, double *afx, double *bfx,
+				double *fs, int x, int nk)
+{
+    int i;
+    double *f = fs + x;         /* f[-k] == fs[x - k] */
+    double sa = 0.0, sb = 0.0;
+
+    for (i = 0; i < nk; i++)
+    {
+	sa += afx[i] * f[-idx[i]];
+	sb += bfx[i] * f[-idx[i]];
+    }
+
+    return sa + sb / x;
+}
+
+/*  The recursions are run on probabilities scaled by a factor
+ *  exp(-lscale) when Pr[S = 0] would otherwise underflow, as is the
+ *  case with large expected numbers of claims. As the scaled
+ *  probabilities grow, this function divides fs[0], ..., fs[x] by a
+ *  power of 2 close to fs[x] --- along with the cumulative
+ *  probability and the constant term of the (a, b, 1) case --- and
+ *  updates 'lscale' accordingly. Values falling below the smallest
+ *  normalized number are negligible and are set to zero to avoid
+ *  slow arithmetic with denormalized numbers. The probabilities are
+ *  'stride' elements apart in 'fs' (see actuar_do_panjerbatch). */
+static void panjer_rescale(double *fs, int x, int stride, double *cumul,
+			   double *term, double *lscale)
+{
+    int i, e;
+    double scale;
+    size_t ix;
+
+    frexp(fs[(size_t) x * stride], &e);
+    scale = ldexp(1.0, -e);	/* exact */
+
+    for (i = 0; i <= x; i++)
+    {
+	ix = (size_t) i * stride;
+	fs[ix] *= scale;
+	if (fs[ix] < DOUBLE_XMIN)
+	    fs[ix] = 0.0;
+    }
+    *cumul *= scale;
+    *term *= scale;
+    *lscale += e * M_LN2;
+}
 
 SEXP actuar_do_panjer(SEXP args)
 {
-    SEXP p0, p1, fs0, sfx, a, b, conv, tol, maxit, echo, sfs;
-    double *fs, *fx, cumul;
+    SEXP p0, p1, fs0, sfx, a, b, conv, tol, maxit, echo, scl, sfs;
+    double *fs, *fx, *afx, *bfx, cumul;
     int upper, m, k, n, x = 1;
+    int *idx, nnz, nk = 0;      /* sparse severity distribution */
     double norm;                /* normalizing constant */
-    double term;                /* constant in the (a, b, 1) case */
+    double term = 0.0;          /* constant in the (a, b, 1) case */
+    double lscale, target;      /* log of scaling factor, stopping value */
 
     /*  The length of vector fs is not known in advance. We opt for a
      *  simple scheme: allocate memory for a vector of size 'size',
@@ -46,6 +160,7 @@ SEXP actuar_do_panjer(SEXP args)
     PROTECT(tol = coerceVector(CAD8R(args), REALSXP));
     PROTECT(maxit = coerceVector(CAD9R(args), INTSXP));
     PROTECT(echo = coerceVector(CAD10R(args), LGLSXP));
+    PROTECT(scl = coerceVector(CAD11R(args), REALSXP));
 
     /* Initialization of some variables */
     fx = REAL(sfx);             /* severity distribution */
@@ -55,11 +170,49 @@ SEXP actuar_do_panjer(SEXP args)
     norm = 1 - REAL(a)[0] * fx[0]; /* normalizing constant */
     n = INTEGER(conv)[0];	   /* number of convolutions to do */
 
+    /* Probabilities fs[x] are computed up to the factor exp(lscale),
+     * hence the recursions stop when cumul * exp(lscale) >= tol. */
+    lscale = REAL(scl)[0];
+    target = REAL(tol)[0] * exp(-lscale);
+
+    /* Vectors a * fx[k] and b * k * fx[k] used in every recursion. */
+    afx = (double *) R_alloc(upper + 1, sizeof(double));
+    bfx = (double *) R_alloc(upper + 1, sizeof(double));
+    for (k = 0; k <= upper; k++)
+    {
+	afx[k] = REAL(a)[0] * fx[k];
+	bfx[k] = REAL(b)[0] * k * fx[k];
+    }
+
+    /* Severity distributions with few support points (scheduled
+     * benefits, excess layers) are stored in sparse form: the
+     * non-zero values of the above vectors are packed at the
+     * beginning of the vectors with their indexes in 'idx'. The
+     * sparse form pays off when no more than one point in SPARSE_RATIO
+     * has a positive probability. */
+    for (nnz = 0, k = 1; k <= upper; k++)
+	if (fx[k] != 0.0)
+	    nnz++;
+    if (nnz * SPARSE_RATIO <= upper)
+    {
+	idx = (int *) R_alloc(nnz, sizeof(int));
+	for (nnz = 0, k = 1; k <= upper; k++)
+	    if (fx[k] != 0.0)
+	    {
+		idx[nnz] = k;
+		afx[nnz] = afx[k];
+		bfx[nnz] = bfx[k];
+		nnz++;
+	    }
+    }
+    else
+	idx = NULL;
+
     /* If printing of recursions was asked for, start by printing a
      * header and the probability at 0. */
     if (LOGICAL(echo)[0])
         Rprintf("x\tPr[S = x]\tCumulative probability\n%d\t%.8g\t%.8g\n",
-                0, fs[0], fs[0]);
+                0, fs[0] * exp(lscale), fs[0] * exp(lscale));
 
     /* (a, b, 0) case (if p0 is NULL) */
     if (isNull(CADR(args)))
@@ -83,16 +236,28 @@ SEXP actuar_do_panjer(SEXP args)
 	    if (x > upper) m = upper; /* upper bound of the sum */
 
             /* Compute probability up to the scaling constant */
-            for (k = 1; k <= m; k++)
-                fs[x] += (REAL(a)[0] + REAL(b)[0] * k / x) * fx[k] * fs[x - k];
+            if (idx)
+            {
+                while (nk < nnz && idx[nk] <= x) nk++;
+                fs[x] = panjer_sum_sparse(idx, afx, bfx, fs, x, nk);
+            }
+            else
+                fs[x] = panjer_sum(afx, bfx, fs, x, m);
             fs[x] = fs[x]/norm;   /* normalization */
             cumul += fs[x];       /* cumulative sum */
 
             if (LOGICAL(echo)[0])
-                Rprintf("%d\t%.8g\t%.8g\n", x, fs[x], cumul);
+                Rprintf("%d\t%.8g\t%.8g\n", x, fs[x] * exp(lscale),
+                        cumul * exp(lscale));
+
+            if (fs[x] > SCALE_MAX)
+            {
+                panjer_rescale(fs, x, 1, &cumul, &term, &lscale);
+                target = REAL(tol)[0] * exp(-lscale);
+            }
 
             x++;
-        } while (cumul < REAL(tol)[0]);
+        } while (cumul < target);
     /* (a, b, 1) case (if p0 is non-NULL) */
     else
     {
@@ -130,53 +295,371 @@ SEXP actuar_do_panjer(SEXP args)
 	    else
 		fxm = fx[m];	/* i.e. additional term */
 
-            for (k = 1; k <= m; k++)
-                fs[x] += (REAL(a)[0] + REAL(b)[0] * k / x) * fx[k] * fs[x - k];
+            if (idx)
+            {
+                while (nk < nnz && idx[nk] <= x) nk++;
+                fs[x] = panjer_sum_sparse(idx, afx, bfx, fs, x, nk);
+            }
+            else
+                fs[x] = panjer_sum(afx, bfx, fs, x, m);
             fs[x] = (fs[x] + fxm * term) / norm;
             cumul += fs[x];
 
             if (LOGICAL(echo)[0])
-                Rprintf("%d\t%.8g\t%.8g\n", x, fs[x], cumul);
+                Rprintf("%d\t%.8g\t%.8g\n", x, fs[x] * exp(lscale),
+                        cumul * exp(lscale));
+
+            if (fs[x] > SCALE_MAX)
+            {
+                panjer_rescale(fs, x, 1, &cumul, &term, &lscale);
+                target = REAL(tol)[0] * exp(-lscale);
+            }
 
             x++;
-        } while (cumul < REAL(tol)[0]);
+        } while (cumul < target);
+    }
+
+    /* Back to the original scale, if needed. */
+    if (lscale != 0.0)
+    {
+	double scale = exp(lscale);
+	for (k = 0; k < x; k++)
+	    fs[k] *= scale;
     }
 
     /* If needed, convolve the distribution obtained above with itself
-     * using a very simple direct technique. Since we want to
-     * continue storing the distribution in array 'fs', we need to
-     * copy the vector in an auxiliary array at each convolution. */
+     * 'n' times. This is done in the frequency domain: one forward
+     * Fourier transform, 'n' successive squarings of the transform
+     * (that is, raising it to the power 2^n) and one inverse
+     * transform. The transform is long enough to hold the final
+     * distribution, so there is no wrap-around. */
     if (n)
     {
-	int i, j, ox;
-	double *ofs;		/* auxiliary array */
+	int i, len, maxf, maxp, *iwork;
+	double re, *im, *work;
 
-	/* Resize 'fs' to its final size after 'n' convolutions. Each
-	 * convolution increases the length from 'x' to '2 * x - 1'. */
-	fs = (double *) S_realloc((char *) fs, (1 << n) * (x - 1) + 1, size, sizeof(double));
+	/* Each convolution increases the length from 'x' to '2 * x -
+	 * 1', hence the final length. Vector 'fs' is padded with
+	 * zeros up to the length of the transform. */
+	x = (1 << n) * (x - 1) + 1;
+	len = nextn235(x);
+	fs = (double *) S_realloc((char *) fs, len, size, sizeof(double));
+	im = (double *) S_alloc(len, sizeof(double)); /* imaginary part */
 
-	/* Allocate enough memory in the auxiliary array for the 'n'
-	 * convolutions. This is just slightly over half the final
-	 * size of 'fs'. */
-	ofs = (double *) S_alloc((1 << (n - 1)) * (x - 1) + 1, sizeof(double));
+	fft_factor(len, &maxf, &maxp);
+	if (maxf == 0)
+	    error(_("fft factorization error"));
+	work = (double *) R_alloc(4 * maxf, sizeof(double));
+	iwork = (int *) R_alloc(maxp, sizeof(int));
 
-	for (k = 0; k < n; k++)
-	{
-	    memcpy(ofs, fs, x * sizeof(double)); /* keep previous array */
-	    ox = x;		/* previous array length */
-	    x = (x << 1) - 1;	/* new array length */
-	    for(i = 0; i < x; i++)
-		fs[i] = 0.0;
-	    for(i = 0; i < ox; i++)
-		for(j = 0; j < ox; j++)
-		    fs[i + j] += ofs[i] * ofs[j];
-	}
+	fft_work(fs, im, 1, len, 1, -1, work, iwork);
+	for (i = 0; i < len; i++)
+	    for (k = 0; k < n; k++)
+	    {
+		re = fs[i];
+		fs[i] = (re - im[i]) * (re + im[i]);
+		im[i] = 2.0 * re * im[i];
+	    }
+	fft_work(fs, im, 1, len, 1, 1, work, iwork);
+
+	/* Normalization of the inverse transform. Round-off errors
+	 * may yield tiny negative values in the far tails. */
+	for (i = 0; i < x; i++)
+	    fs[i] = fmax2(fs[i] / len, 0.0);
     }
 
     /*  Copy the values of fs to a SEXP which will be returned to R. */
     PROTECT(sfs = allocVector(REALSXP, x));
     memcpy(REAL(sfs), fs, x * sizeof(double));
 
-    UNPROTECT(11);
+    UNPROTECT(12);
+    return(sfs);
+}
+
+/*  Panjer recursions for K frequency distributions sharing the same
+ *  severity distribution. Arguments are the same as for
+ *  actuar_do_panjer(), but for 'convolve' and 'echo' that are not
+ *  supported, with vectors of length K for the parameters of the
+ *  frequency distributions.
+ *
+ *  The K distributions are stored interleaved, that is fs[x * K + j]
+ *  is Pr[S = x] for the j-th model. This way, every value fx[k] is
+ *  read once per recursion for all models and the innermost loop
+ *  runs over contiguous memory. The recursions stop when all
+ *  distributions are complete.
+ *
+ *  The last argument is the vector of the logarithms of the initial
+ *  scaling factors of the models, as in actuar_do_panjer(). Each
+ *  model is rescaled independently. */
+SEXP actuar_do_panjerbatch(SEXP args)
+{
+    SEXP p0, p1, fs0, sfx, a, b, tol, maxit, scl, sfs;
+    double *fs, *fx, *kfx, *fsx, *fsk, *sa, *sb, *norm, *term, *cumul;
+    double *lscale, *target, fxm;
+    int upper, K, m, i, j, k, x = 1, done;
+
+    /*  Same allocation scheme as in actuar_do_panjer(), with 'size'
+     *  rows of K values. */
+    int size = INITSIZE;
+
+    PROTECT(p0 = coerceVector(CADR(args), REALSXP));
+    PROTECT(p1 = coerceVector(CADDR(args), REALSXP));
+    PROTECT(fs0 = coerceVector(CADDDR(args), REALSXP));
+    PROTECT(sfx = coerceVector(CAD4R(args), REALSXP));
+    PROTECT(a = coerceVector(CAD5R(args), REALSXP));
+    PROTECT(b = coerceVector(CAD6R(args), REALSXP));
+    PROTECT(tol = coerceVector(CAD7R(args), REALSXP));
+    PROTECT(maxit = coerceVector(CAD8R(args), INTSXP));
+    PROTECT(scl = coerceVector(CAD9R(args), REALSXP));
+
+    /* Initialization of some variables */
+    K = length(a);              /* number of frequency models */
+    fx = REAL(sfx);             /* severity distribution */
+    upper = length(sfx) - 1;    /* severity distribution support upper bound */
+    fs = (double *) S_alloc((size_t) size * K, sizeof(double));
+
+    /* Vector k * fx[k] used in every recursion. */
+    kfx = (double *) R_alloc(upper + 1, sizeof(double));
+    for (k = 0; k <= upper; k++)
+	kfx[k] = k * fx[k];
+
+    /* Per model accumulators and constants. In the (a, b, 0) case,
+     * the constant term of the (a, b, 1) case is simply 0. */
+    sa = (double *) R_alloc(K, sizeof(double));
+    sb = (double *) R_alloc(K, sizeof(double));
+    norm = (double *) R_alloc(K, sizeof(double));
+    term = (double *) R_alloc(K, sizeof(double));
+    cumul = (double *) R_alloc(K, sizeof(double));
+    lscale = (double *) R_alloc(K, sizeof(double));
+    target = (double *) R_alloc(K, sizeof(double));
+    for (j = 0; j < K; j++)
+    {
+	fs[j] = REAL(fs0)[j];
+	cumul[j] = REAL(fs0)[j];
+	norm[j] = 1 - REAL(a)[j] * fx[0];
+	term[j] = isNull(CADR(args)) ? 0.0 :
+	    REAL(p1)[j] - (REAL(a)[j] + REAL(b)[j]) * REAL(p0)[j];
+	lscale[j] = REAL(scl)[j];
+	target[j] = REAL(tol)[0] * exp(-lscale[j]);
+    }
+
+    do
+    {
+	/* Stop after 'maxit' recursions and issue warning. */
+	if (x > INTEGER(maxit)[0])
+	{
+	    warning(_("maximum number of recursions reached before the probability distribution was complete"));
+	    break;
+	}
+
+	/* If fs is too small, double its size */
+	if (x >= size)
+	{
+	    fs = (double *) S_realloc((char *) fs, (size_t) (size << 1) * K,
+				      (size_t) size * K, sizeof(double));
+	    size = size << 1;
+	}
+
+	m = x;
+	if (x > upper)
+	{
+	    m = upper;		/* upper bound of the sum */
+	    fxm = 0.0;		/* i.e. no additional term */
+	}
+	else
+	    fxm = fx[m];	/* i.e. additional term */
+
+	for (j = 0; j < K; j++)
+	    sa[j] = sb[j] = 0.0;
+	for (k = 1; k <= m; k++)
+	{
+	    fsk = fs + (size_t) (x - k) * K;
+	    for (j = 0; j < K; j++)
+	    {
+		sa[j] += fx[k] * fsk[j];
+		sb[j] += kfx[k] * fsk[j];
+	    }
+	}
+
+	fsx = fs + (size_t) x * K;
+	done = 1;
+	for (j = 0; j < K; j++)
+	{
+	    fsx[j] = (REAL(a)[j] * sa[j] + REAL(b)[j] * sb[j] / x
+		      + fxm * term[j]) / norm[j];
+	    cumul[j] += fsx[j];
+
+	    if (fsx[j] > SCALE_MAX)
+	    {
+		panjer_rescale(fs + j, x, K, &cumul[j], &term[j], &lscale[j]);
+		target[j] = REAL(tol)[0] * exp(-lscale[j]);
+	    }
+	    if (cumul[j] < target[j])
+		done = 0;
+	}
+
+	x++;
+    } while (!done);
+
+    /*  Copy the values of fs, back to the original scale, to a matrix
+     *  with one column per model, which will be returned to R. */
+    PROTECT(sfs = allocMatrix(REALSXP, x, K));
+    for (j = 0; j < K; j++)
+    {
+	double scale = exp(lscale[j]);
+	for (i = 0; i < x; i++)
+	    REAL(sfs)[i + (size_t) j * x] = fs[(size_t) i * K + j] * scale;
+    }
+
+    UNPROTECT(10);
+    return(sfs);
+}
+
+/*  De Pril recursion for the individual risk model: policy j has
+ *  probability q[j] to produce a claim of (integer) amount b[j].
+ *  With r = q/(1 - q), the recursion reads
+ *
+ *    f(x) = (1/x) sum_{i = 1}^{min(x, I)} sum_{k = 1}^{x/i} h(i, k) f(x - ik)
+ *
+ *  where I is the largest amount and h(i, k) = i (-1)^(k + 1) times
+ *  the sum of r^k over policies with amount i. The coefficients
+ *  decrease geometrically with k; the sum over k is truncated at the
+ *  smallest order K such that the bound of Dhaene and De Pril (1994)
+ *  on the total variation error of this Kornya approximation is
+ *  below the machine epsilon. The cost is then of the order of the
+ *  length of the support times the number of distinct amounts times
+ *  K. The recursions are run on scaled probabilities as in
+ *  actuar_do_panjer() since Pr[S = 0] underflows in large
+ *  portfolios. Requires q[j] < 0.5 (checked in R). */
+SEXP actuar_do_depril(SEXP args)
+{
+    SEXP sq, sb, tol, maxit, sfs;
+    double *q, *fs, *h, r, rmax = 0.0, qmax = 0.0, pw, s, cumul;
+    double lscale = 0.0, target, term = 0.0, total = 0.0;
+    int *b, *pos, *lev, n, N = 0, nlev = 0, bmax = 0, K, i, j, k, l, y, x = 1;
+
+    int size = INITSIZE;
+    fs = (double *) S_alloc(size, sizeof(double));
+
+    PROTECT(sq = coerceVector(CADR(args), REALSXP));
+    PROTECT(sb = coerceVector(CADDR(args), INTSXP));
+    PROTECT(tol = coerceVector(CADDDR(args), REALSXP));
+    PROTECT(maxit = coerceVector(CAD4R(args), INTSXP));
+
+    q = REAL(sq);
+    b = INTEGER(sb);
+    n = length(sq);
+
+    /* Policies with a zero probability or a zero amount play no
+     * role. Compute log Pr[S = 0] = sum log(1 - q) and collect the
+     * distinct amounts in increasing order in 'lev'; 'pos' maps an
+     * amount to its position in 'lev'. */
+    for (j = 0; j < n; j++)
+    {
+	if (q[j] == 0.0 || b[j] == 0)
+	    continue;
+	N++;
+	lscale += log1p(-q[j]);
+	total += b[j];
+	if (b[j] > bmax) bmax = b[j];
+	if (q[j] > qmax) qmax = q[j];
+    }
+    rmax = qmax / (1 - qmax);
+
+    pos = (int *) R_alloc(bmax + 1, sizeof(int));
+    for (i = 0; i <= bmax; i++)
+	pos[i] = -1;
+    for (j = 0; j < n; j++)
+	if (q[j] != 0.0 && b[j] != 0)
+	    pos[b[j]] = 0;
+    lev = (int *) R_alloc(bmax + 1, sizeof(int));
+    for (i = 1; i <= bmax; i++)
+	if (pos[i] == 0)
+	{
+	    pos[i] = nlev;
+	    lev[nlev++] = i;
+	}
+
+    /* Order of the approximation: smallest K such that
+     * N rmax^(K + 1) (1 - qmax)/((K + 1) (1 - 2 qmax)) <= epsilon,
+     * an upper bound for the sum over policies of Dhaene and De
+     * Pril. No need to go beyond the maximum length of the support. */
+    for (K = 1, pw = rmax * rmax;
+	 K < INTEGER(maxit)[0] &&
+	     N * pw * (1 - qmax) / ((K + 1) * (1 - 2 * qmax)) > DOUBLE_EPS;
+	 K++)
+	pw *= rmax;
+
+    /* Coefficients h(i, k) stored in h[l * K + k - 1] for the l-th
+     * distinct amount i = lev[l]. */
+    h = (double *) S_alloc(nlev * K, sizeof(double));
+    for (j = 0; j < n; j++)
+    {
+	if (q[j] == 0.0 || b[j] == 0)
+	    continue;
+	r = q[j] / (1 - q[j]);
+	l = pos[b[j]] * K;
+	for (k = 0, pw = r; k < K && pw > 0.0; k++, pw *= r)
+	    h[l + k] += pw;
+    }
+    for (l = 0; l < nlev; l++)
+	for (k = 0; k < K; k++)
+	    h[l * K + k] *= (k % 2) ? -lev[l] : lev[l];
+
+    /* Start with the unscaled value of Pr[S = 0] unless it
+     * underflows. */
+    if (exp(lscale) < DOUBLE_XMIN)
+	fs[0] = 1.0;
+    else
+    {
+	fs[0] = exp(lscale);
+	lscale = 0.0;
+    }
+    cumul = fs[0];
+    target = REAL(tol)[0] * exp(-lscale);
+
+    /* The distribution is complete once x is larger than the sum of
+     * the amounts. */
+    while (cumul < target && x <= total)
+    {
+	if (x > INTEGER(maxit)[0])
+	{
+	    warning(_("maximum number of recursions reached before the probability distribution was complete"));
+	    break;
+	}
+
+	if (x >= size)
+	{
+	    fs = (double *) S_realloc((char *) fs, size << 1, size, sizeof(double));
+	    size = size << 1;
+	}
+
+	s = 0.0;
+	for (l = 0; l < nlev && lev[l] <= x; l++)
+	{
+	    i = lev[l];
+	    for (k = 0, y = x - i; k < K && y >= 0; k++, y -= i)
+		s += h[l * K + k] * fs[y];
+	}
+	fs[x] = s / x;
+	cumul += fs[x];
+
+	if (fs[x] > SCALE_MAX)
+	{
+	    panjer_rescale(fs, x, 1, &cumul, &term, &lscale);
+	    target = REAL(tol)[0] * exp(-lscale);
+	}
+
+	x++;
+    }
+
+    /* Back to the original scale. The alternating signs of the
+     * coefficients may yield tiny negative values in the tails. */
+    PROTECT(sfs = allocVector(REALSXP, x));
+    r = exp(lscale);
+    for (k = 0; k < x; k++)
+	REAL(sfs)[k] = fmax2(fs[k] * r, 0.0);
+
+    UNPROTECT(5);
     return(sfs);
 }
@@ -162,3 +162,112 @@ double levparalogis(double limit, double shape, double scale, double order,
 	/ gammafn(shape)
         + ACT_DLIM__0(limit, order) * R_pow(u, shape);
 }
+
+/*  Batch versions of the density and distribution functions for
+ *  parameters of length one (see dpq.c): the parameters are validated
+ *  and the constants depending on them are computed once for the
+ *  whole vector 'x'. Missing values in 'x' are handled by the caller.
+ */
+void dparalogis_batch(const double *x, double *y, int n, const double *par,
+                      int give_log)
+{
+    int i;
+    double shape = par[0], scale = par[1], xi;
+    double lshape, lscale, y0, lx, tmp, logu, log1mu;
+
+    if (!R_FINITE(shape) ||
+        !R_FINITE(scale) ||
+        shape <= 0.0 ||
+        scale <= 0.0)
+    {
+        for (i = 0; i < n; i++)
+            y[i] = R_NaN;
+        return;
+    }
+
+    lshape = 2.0 * log(shape);
+    lscale = log(scale);
+    y0 = (shape < 1) ? R_PosInf : (shape > 1) ? ACT_D__0 : ACT_D_val(1.0 / scale);
+
+    for (i = 0; i < n; i++)
+    {
+        xi = x[i];
+        if (!R_FINITE(xi) || xi < 0.0)
+            y[i] = ACT_D__0;
+        else if (xi == 0.0)
+            y[i] = y0;
+        else
+        {
+            lx = log(xi);
+            tmp = shape * (lx - lscale);
+            logu = - log1pexp(tmp);
+            log1mu = - log1pexp(-tmp);
+            y[i] = ACT_D_exp(lshape + shape * logu + log1mu - lx);
+        }
+    }
+}
+
+void pparalogis_batch(const double *x, double *y, int n, const double *par,
+                      int lower_tail, int log_p)
+{
+    int i;
+    double shape = par[0], scale = par[1], xi;
+    double lscale, u;
+
+    if (!R_FINITE(shape) ||
+        !R_FINITE(scale) ||
+        shape <= 0.0 ||
+        scale <= 0.0)
+    {
+        for (i = 0; i < n; i++)
+            y[i] = R_NaN;
+        return;
+    }
+
+    lscale = log(scale);
+
+    for (i = 0; i < n; i++)
+    {
+        xi = x[i];
+        if (xi <= 0)
+            y[i] = ACT_DT_0;
+        else
+        {
+            u = exp(-log1pexp(shape * (log(xi) - lscale)));
+            y[i] = ACT_DT_Cval(R_pow(u, shape));
+        }
+    }
+}
+
+/*  Gradients for the log-likelihood routines (see trbeta.c): the
+ *  paralogistic is the transformed beta with shape1 = shape2 = shape
+ *  and shape3 = 1; the derivative with respect to 'shape' is the sum
+ *  of the first two.
+ */
+double dparalogis_grad(double x, const double *par, double *grad)
+{
+    double g[4], lf = dparalogis(x, par[0], par[1], /*give_log*/1);
+
+    if (R_FINITE(lf))
+    {
+	trbeta_dgrad_raw(x, par[0], par[0], 1.0, par[1], 0, g);
+	grad[0] = g[0] + g[1];
+	grad[1] = g[3];
+    }
+
+    return lf;
+}
+
+double pparalogis_grad(double q, const double *par, double *grad)
+{
+    double g[4], ls = pparalogis(q, par[0], par[1], /*lower_tail*/0, /*log_p*/1);
+
+    if (R_FINITE(ls))
+    {
+	trbeta_pgrad_raw(q, par[0], par[0], 1.0, par[1], g);
+	grad[0] = g[0] + g[1];
+	grad[1] = g[3];
+    }
+
+    return ls;
+}
@@ -144,3 +144,110 @@ double levpareto(double limit, double shape, double scale, double order,
 	/ gammafn(shape)
         + ACT_DLIM__0(limit, order) * R_pow(u, shape);
 }
+
+/*  Batch versions of the density and distribution functions for
+ *  parameters of length one (see dpq.c): the parameters are validated
+ *  and the constants depending on them are computed once for the
+ *  whole vector 'x'. Missing values in 'x' are handled by the caller.
+ */
+void dpareto_batch(const double *x, double *y, int n, const double *par,
+                   int give_log)
+{
+    int i;
+    double shape = par[0], scale = par[1], xi;
+    double lshape, lscale, y0, lx, tmp, logu, log1mu;
+
+    if (!R_FINITE(shape) ||
+        !R_FINITE(scale) ||
+        shape <= 0.0 ||
+        scale <= 0.0)
+    {
+        for (i = 0; i < n; i++)
+            y[i] = R_NaN;
+        return;
+    }
+
+    lshape = log(shape);
+    lscale = log(scale);
+    y0 = ACT_D_val(shape / scale);
+
+    for (i = 0; i < n; i++)
+    {
+        xi = x[i];
+        if (!R_FINITE(xi) || xi < 0.0)
+            y[i] = ACT_D__0;
+        else if (xi == 0.0)
+            y[i] = y0;
+        else
+        {
+            lx = log(xi);
+            tmp = lx - lscale;
+            logu = - log1pexp(tmp);
+            log1mu = - log1pexp(-tmp);
+            y[i] = ACT_D_exp(lshape + shape * logu + log1mu - lx);
+        }
+    }
+}
+
+void ppareto_batch(const double *x, double *y, int n, const double *par,
+                   int lower_tail, int log_p)
+{
+    int i;
+    double shape = par[0], scale = par[1], xi;
+    double lscale, u;
+
+    if (!R_FINITE(shape) ||
+        !R_FINITE(scale) ||
+        shape <= 0.0 ||
+        scale <= 0.0)
+    {
+        for (i = 0; i < n; i++)
+            y[i] = R_NaN;
+        return;
+    }
+
+    lscale = log(scale);
+
+    for (i = 0; i < n; i++)
+    {
+        xi = x[i];
+        if (xi <= 0)
+            y[i] = ACT_DT_0;
+        else
+        {
+            u = exp(-log1pexp(log(xi) - lscale));
+            y[i] = ACT_DT_Cval(R_pow(u, shape));
+        }
+    }
+}
+
+/*  Gradients for the log-likelihood routines (see trbeta.c): the
+ *  Pareto is the transformed beta with shape2 = shape3 = 1.
+ */
+double dpareto_grad(double x, const double *par, double *grad)
+{
+    double g[4], lf = dpareto(x, par[0], par[1], /*give_log*/1);
+
+    if (R_FINITE(lf))
+    {
+	trbeta_dgrad_raw(x, par[0], 1.0, 1.0, par[1], 0, g);
+	grad[0] = g[0];
+	grad[1] = g[3];
+    }
+
+    return lf;
+}
+
+double ppareto_grad(double q, const double *par, double *grad)
+{
+    double g[4], ls = ppareto(q, par[0], par[1], /*lower_tail*/0, /*log_p*/1);
+
+    if (R_FINITE(ls))
+    {
+	trbeta_pgrad_raw(q, par[0], 1.0, 1.0, par[1], g);
+	grad[0] = g[0];
+	grad[1] = g[3];
+    }
+
+    return ls;
+}
@@ -119,3 +119,104 @@ double levpareto1(double limit, double shape, double min, double order,
     return shape * R_pow(min, order) / tmp
         - order * R_pow(min, shape) / (tmp * R_pow(limit, tmp));
 }
+
+/*  Batch versions of the density and distribution functions for
+ *  parameters of length one (see dpq.c): the parameters are validated
+ *  and the constants depending on them are computed once for the
+ *  whole vector 'x'. Missing values in 'x' are handled by the caller.
+ */
+void dpareto1_batch(const double *x, double *y, int n, const double *par,
+                    int give_log)
+{
+    int i;
+    double shape = par[0], min = par[1], xi;
+    double lshape, shape1;
+
+    if (!R_FINITE(shape) ||
+        !R_FINITE(min) ||
+        shape <= 0.0 ||
+        min <= 0.0)
+    {
+        for (i = 0; i < n; i++)
+            y[i] = R_NaN;
+        return;
+    }
+
+    lshape = log(shape) + shape * log(min);
+    shape1 = shape + 1.0;
+
+    for (i = 0; i < n; i++)
+    {
+        xi = x[i];
+        if (!R_FINITE(xi) || xi < min)
+            y[i] = ACT_D__0;
+        else
+            y[i] = ACT_D_exp(lshape - shape1 * log(xi));
+    }
+}
+
+void ppareto1_batch(const double *x, double *y, int n, const double *par,
+                    int lower_tail, int log_p)
+{
+    int i;
+    double shape = par[0], min = par[1], xi;
+
+    if (!R_FINITE(shape) ||
+        !R_FINITE(min) ||
+        shape <= 0.0 ||
+        min <= 0.0)
+    {
+        for (i = 0; i < n; i++)
+            y[i] = R_NaN;
+        return;
+    }
+
+    for (i = 0; i < n; i++)
+    {
+        xi = x[i];
+        if (xi <= min)
+            y[i] = ACT_DT_0;
+        else
+            y[i] = ACT_DT_Cval(R_pow(min / xi, shape));
+    }
+}
+
+/*  Gradients for the log-likelihood routines (see loglik.c). The
+ *  log-density is log(shape) + shape * log(min) - (shape + 1) * log(x)
+ *  and the log of the survival function is shape * log(min/x), both
+ *  for x > min.
+ */
+double dpareto1_grad(double x, const double *par, double *grad)
+{
+    double shape = par[0], min = par[1];
+    double lf = dpareto1(x, shape, min, /*give_log*/1);
+
+    if (R_FINITE(lf))
+    {
+	grad[0] = 1.0 / shape + log(min) - log(x);
+	grad[1] = shape / min;
+    }
+
+    return lf;
+}
+
+double ppareto1_grad(double q, const double *par, double *grad)
+{
+    double shape = par[0], min = par[1];
+    double ls = ppareto1(q, shape, min, /*lower_tail*/0, /*log_p*/1);
+
+    if (!R_FINITE(ls))
+	return ls;
+
+    /* survival function equal to one */
+    if (q <= min)
+    {
+	grad[0] = grad[1] = 0.0;
+	return ls;
+    }
+
+    grad[0] = log(min) - log(q);
+    grad[1] = shape / min;
+
+    return ls;
+}
@@ -11,11 +11,49 @@
 #include <Rmath.h>
 #include <Rinternals.h>
 #include <R_ext/Memory.h>
+#include <R_ext/BLAS.h>
 #include "actuar.h"
 #include "locale.h"
 #include "dpq.h"
 
-double dphtype(double x, double *pi, double *T, int m, int give_log)
+/* Whether the product pi * exp(M) * b is computed with the action of
+ * the matrix exponential on pi rather than the full exponential:
+ * for large matrices, unless the number of terms of the
+ * uniformization is too high. */
+static int phtype_use_expmv(double *M, int m)
+{
+    int i;
+    double lambda = 0.0;
+
+    if (m < EXPMV_MIN)
+        return 0;
+    for (i = 0; i < m; i++)
+        lambda = fmax2(lambda, -M[i + i * m]);
+    return lambda < EXPMV_TERMS * m;
+}
+
+/* Product pi * exp(M) * b in a workspace of EXPMPROD_DWORK(m)
+ * doubles and EXPM_IWORK(m) integers. */
+static double phtype_expmprod_work(double *pi, double *M, double *b, int m,
+                                   double *dwork, int *iwork)
+{
+    int ione = 1;
+
+    if (phtype_use_expmv(M, m))
+    {
+        actuar_expmv_work(pi, M, m, dwork, dwork + m);
+        return F77_CALL(ddot)(&m, dwork, &ione, b, &ione);
+    }
+    return actuar_expmprod_work(pi, M, b, m, dwork, iwork);
+}
+
+/* The *_work() versions of the density and distribution functions
+ * compute in workspaces of PHTYPE_DWORK(m) doubles and
+ * PHTYPE_IWORK(m) integers provided by the caller and do not call
+ * the R API, so they may be used in threads. They return NaN if the
+ * matrix exponential could not be computed. */
+double dphtype_work(double x, double *pi, double *T, int m, int give_log,
+                    double *dwork, int *iwork)
 {
     /*  Density function is
      *
@@ -41,12 +79,12 @@ double dphtype(double x, double *pi, double *T, int m, int give_log)
     }
 
     int i, j, ij;
-    double *t, *tmp;
+    double *t = dwork, *tmp = dwork + m;
 
     /* Build vector t (equal to minus the row sums of matrix T) and
      * matrix tmp = x * T. */
-    t = (double *) S_alloc(m, sizeof(double)); /* initialized to 0 */
-    tmp = (double *) R_alloc(m * m, sizeof(double));
+    for (i = 0; i < m; i++)
+        t[i] = 0.0;
     for (i = 0; i < m; i++)
         for (j = 0; j < m; j++)
         {
@@ -55,11 +93,19 @@ double dphtype(double x, double *pi, double *T, int m, int give_log)
             tmp[ij] = x * T[ij];
         }
 
-    return ACT_D_val(actuar_expmprod(pi, tmp, t, m));
+    return ACT_D_val(phtype_expmprod_work(pi, tmp, t, m,
+                                          tmp + m * m, iwork));
 }
 
-double pphtype(double q, double *pi, double *T, int m, int lower_tail,
-               int log_p)
+double dphtype(double x, double *pi, double *T, int m, int give_log)
+{
+    return dphtype_work(x, pi, T, m, give_log,
+                        (double *) R_alloc(PHTYPE_DWORK(m), sizeof(double)),
+                        (int *) R_alloc(PHTYPE_IWORK(m), sizeof(int)));
+}
+
+double pphtype_work(double q, double *pi, double *T, int m, int lower_tail,
+                    int log_p, double *dwork, int *iwork)
 {
     /*  Cumulative distribution function is
      *
@@ -84,17 +130,378 @@ double pphtype(double q, double *pi, double *T, int m, int lower_tail,
     }
 
     int i;
-    double *e, *tmp;
+    double *e = dwork, *tmp = dwork + m;
 
     /* Create the 1-vector and multiply each element of T by q. */
-    e = (double *) R_alloc(m, sizeof(double));
     for (i = 0; i < m; i++)
         e[i] = 1;
-    tmp = (double *) R_alloc(m * m, sizeof(double));
     for (i = 0; i < m * m; i++)
         tmp[i] = q * T[i];
 
-    return ACT_DT_Cval(actuar_expmprod(pi, tmp, e, m));
+    return ACT_DT_Cval(phtype_expmprod_work(pi, tmp, e, m,
+                                            tmp + m * m, iwork));
+}
+
+double pphtype(double q, double *pi, double *T, int m, int lower_tail,
+               int log_p)
+{
+    return pphtype_work(q, pi, T, m, lower_tail, log_p,
+                        (double *) R_alloc(PHTYPE_DWORK(m), sizeof(double)),
+                        (int *) R_alloc(PHTYPE_IWORK(m), sizeof(int)));
+}
+
+/* Evaluation of the density and distribution functions on a grid
+ * of points. The values pi * exp(x[k] * T) are computed by stepping
+ * forward across the 'n' sorted positive and finite values of 'x':
+ *
+ *   pi * exp(x[k] * T) = pi * exp(x[k-1] * T) * exp((x[k] - x[k-1]) * T),
+ *
+ * so the matrix exponential is only computed when the step changes;
+ * each other point costs a vector-matrix product. Steps within
+ * PHTYPE_GRID_RTOL of the previous one, as those of seq(), are deemed
+ * equal. For large matrices, a new step is first taken with the
+ * action of the matrix exponential (see actuar_expmv_work() in
+ * util.c) and the full exponential is only computed when the step is
+ * repeated. Values are stored in y[ord[k]]. Workspaces are of
+ * PHTYPE_GRID_DWORK(m) doubles and PHTYPE_IWORK(m) integers and the
+ * functions do not call the R API. Values are NaN from the point
+ * where the matrix exponential could not be computed. */
+static void phtype_grid_work(double *x, int *ord, int n, double *pi,
+                             double *T, int m, double *b, double *y,
+                             double *dwork, int *iwork)
+{
+    int i, k, info, same, Evalid = 0, ione = 1;
+    double d, h = 0.0, xcur = 0.0, one = 1.0, zero = 0.0;
+    double *E = dwork, *M = E + m * m, *v = M + m * m, *w = v + m,
+        *ework = w + m, *tmp;
+
+    Memcpy(v, pi, m);
+    for (k = 0; k < n; k++)
+    {
+        if ((d = x[k] - xcur) > 0.0)
+        {
+            same = fabs(d - h) <= PHTYPE_GRID_RTOL * x[k];
+            if (same && Evalid)
+                xcur += h;
+            else
+            {
+                h = d;
+                for (i = 0; i < m * m; i++)
+                    M[i] = h * T[i];
+                xcur = x[k];
+
+                /* New step: w = v * exp(d * T) */
+                if (!same && phtype_use_expmv(M, m))
+                {
+                    actuar_expmv_work(v, M, m, w, ework);
+                    tmp = v; v = w; w = tmp;
+                    Evalid = 0;
+                    y[ord[k]] = F77_CALL(ddot)(&m, v, &ione, b, &ione);
+                    continue;
+                }
+
+                /* Repeated step or small matrix: E = exp(d * T) */
+                if (actuar_expm_work(M, m, E, ework, iwork, &info))
+                {
+                    for (; k < n; k++)
+                        y[ord[k]] = R_NaN;
+                    return;
+                }
+                Evalid = 1;
+            }
+
+            /* Product      w     := v     * E
+             * (Dimensions: 1 x m    1 x m   m x m) */
+            F77_CALL(dgemv)("T", &m, &m, &one, E, &m, v, &ione,
+                            &zero, w, &ione);
+            tmp = v; v = w; w = tmp;
+        }
+        y[ord[k]] = F77_CALL(ddot)(&m, v, &ione, b, &ione);
+    }
+}
+
+void dphtype_grid(double *x, int *ord, int n, double *pi, double *T,
+                  int m, int give_log, double *y, double *dwork,
+                  int *iwork)
+{
+    int i, j, k;
+    double *t = dwork;
+
+    /* Vector t equal to minus the row sums of matrix T. */
+    for (i = 0; i < m; i++)
+        t[i] = 0.0;
+    for (j = 0; j < m; j++)
+        for (i = 0; i < m; i++)
+            t[i] -= T[i + j * m];
+
+    phtype_grid_work(x, ord, n, pi, T, m, t, y, dwork + m, iwork);
+
+    for (k = 0; k < n; k++)
+        y[ord[k]] = ACT_D_val(y[ord[k]]);
+}
+
+void pphtype_grid(double *x, int *ord, int n, double *pi, double *T,
+                  int m, int lower_tail, int log_p, double *y,
+                  double *dwork, int *iwork)
+{
+    int i, k;
+    double *e = dwork;
+
+    for (i = 0; i < m; i++)
+        e[i] = 1.0;
+
+    phtype_grid_work(x, ord, n, pi, T, m, e, y, dwork + m, iwork);
+
+    for (k = 0; k < n; k++)
+        y[ord[k]] = ACT_DT_Cval(y[ord[k]]);
+}
+
+/* Density and distribution functions, raw moments and moment
+ * generating function for a sub-intensity matrix in the compact form
+ *
+ *   T = B + u v',
+ *
+ * where B is upper bidiagonal with diagonal 'd' and superdiagonal 's'
+ * (Erlang and Coxian distributions and their mixtures) and u v' is
+ * an optional rank one term with u, v >= 0 (u = v = NULL when
+ * absent), as in the representation of the probability of ruin in
+ * the Cramer-Lundberg model. Products with T and solutions of linear
+ * systems in T cost O(m) operations, the latter with the
+ * Sherman-Morrison formula. The functions use a workspace of
+ * PHTYPE_BIDIAG_DWORK(m) doubles. */
+
+/* w := w + alpha * y * (scale * T) */
+static void bidiag_vecmat(double *y, void *M, int m, double alpha, double *w)
+{
+    int i;
+    double yu, a;
+    phtype_bidiag_struct *T = M;
+
+    a = alpha * T->scale;
+    for (i = 0; i < m; i++)
+        w[i] += a * y[i] * T->d[i];
+    for (i = 0; i < m - 1; i++)
+        w[i + 1] += a * y[i] * T->s[i];
+    if (T->u)
+    {
+        yu = 0.0;
+        for (i = 0; i < m; i++)
+            yu += y[i] * T->u[i];
+        for (i = 0; i < m; i++)
+            w[i] += a * yu * T->v[i];
+    }
+}
+
+/* Largest absolute value of the diagonal of T. */
+static double bidiag_lambda(phtype_bidiag_struct *T)
+{
+    int i;
+    double lambda = 0.0;
+
+    for (i = 0; i < T->m; i++)
+        lambda = fmax2(lambda, -(T->d[i] + (T->u ? T->u[i] * T->v[i] : 0.0)));
+    return lambda;
+}
+
+/* Exit rates vector t = -T * e. */
+static void bidiag_exit(phtype_bidiag_struct *T, double *t)
+{
+    int i, m = T->m;
+    double vsum = 0.0;
+
+    if (T->u)
+        for (i = 0; i < m; i++)
+            vsum += T->v[i];
+    for (i = 0; i < m; i++)
+        t[i] = -(T->d[i] + ((i < m - 1) ? T->s[i] : 0.0) +
+                 (T->u ? T->u[i] * vsum : 0.0));
+}
+
+/* Solution of (c * I - B) z = r, upper bidiagonal, by back
+ * substitution. */
+static void bidiag_backsolve(phtype_bidiag_struct *T, double c, double *r,
+                             double *z)
+{
+    int i, m = T->m;
+
+    z[m - 1] = r[m - 1] / (c - T->d[m - 1]);
+    for (i = m - 2; i >= 0; i--)
+        z[i] = (r[i] + T->s[i] * z[i + 1]) / (c - T->d[i]);
+}
+
+/* Solution of (c * I - T) z = r with the Sherman-Morrison formula
+ * for the rank one term; 'work' holds m doubles. */
+static void bidiag_solve(phtype_bidiag_struct *T, double c, double *r,
+                         double *z, double *work)
+{
+    int i, m = T->m;
+    double vz = 0.0, vw = 0.0;
+
+    bidiag_backsolve(T, c, r, z);
+    if (!T->u)
+        return;
+
+    /* (A - u v')^{-1} r = A^{-1} r + A^{-1} u (v' A^{-1} r)/(1 - v' A^{-1} u) */
+    bidiag_backsolve(T, c, T->u, work);
+    for (i = 0; i < m; i++)
+    {
+        vz += T->v[i] * z[i];
+        vw += T->v[i] * work[i];
+    }
+    for (i = 0; i < m; i++)
+        z[i] += work[i] * vz / (1.0 - vw);
+}
+
+/* Values pi * exp(x[k] * T) * b for the sorted positive and finite
+ * values of 'x', stored in y[ord[k]], by stepping forward with the
+ * action of the matrix exponential. */
+static void bidiag_grid_work(double *x, int *ord, int n, double *pi,
+                             phtype_bidiag_struct *T, double *b, double *y,
+                             double *dwork)
+{
+    int i, k, m = T->m;
+    double d, xcur = 0.0, lambda = bidiag_lambda(T), z;
+    double *v = dwork, *w = v + m, *ework = w + m, *tmp;
+
+    Memcpy(v, pi, m);
+    for (k = 0; k < n; k++)
+    {
+        if ((d = x[k] - xcur) > 0.0)
+        {
+            T->scale = d;
+            actuar_expmv_op_work(v, d * lambda, bidiag_vecmat, T, m, w,
+                                 ework);
+            tmp = v; v = w; w = tmp;
+            xcur = x[k];
+        }
+        z = 0.0;
+        for (i = 0; i < m; i++)
+            z += v[i] * b[i];
+        y[ord[k]] = z;
+    }
+}
+
+void dphtype_bidiag_grid(double *x, int *ord, int n, double *pi,
+                         phtype_bidiag_struct *T, int give_log, double *y,
+                         double *dwork)
+{
+    int k;
+    double *t = dwork;
+
+    bidiag_exit(T, t);
+    bidiag_grid_work(x, ord, n, pi, T, t, y, dwork + T->m);
+
+    for (k = 0; k < n; k++)
+        y[ord[k]] = ACT_D_val(y[ord[k]]);
+}
+
+void pphtype_bidiag_grid(double *x, int *ord, int n, double *pi,
+                         phtype_bidiag_struct *T, int lower_tail, int log_p,
+                         double *y, double *dwork)
+{
+    int i, k;
+    double *e = dwork;
+
+    for (i = 0; i < T->m; i++)
+        e[i] = 1.0;
+    bidiag_grid_work(x, ord, n, pi, T, e, y, dwork + T->m);
+
+    for (k = 0; k < n; k++)
+        y[ord[k]] = ACT_DT_Cval(y[ord[k]]);
+}
+
+/* Values at a single point; only the cases x <= 0 and x = Inf are
+ * not handled by the grid functions above. */
+double dphtype_bidiag(double x, double *pi, phtype_bidiag_struct *T,
+                      int give_log, double *dwork)
+{
+    int i, ord = 0;
+    double y, z = 0.0;
+
+    if (!R_FINITE(x) || x < 0.0)
+        return ACT_D__0;
+
+    if (x == 0.0)
+    {
+        for (i = 0; i < T->m; i++)
+            z += pi[i];
+        return ACT_D_Clog(z);
+    }
+
+    dphtype_bidiag_grid(&x, &ord, 1, pi, T, give_log, &y, dwork);
+    return y;
+}
+
+double pphtype_bidiag(double q, double *pi, phtype_bidiag_struct *T,
+                      int lower_tail, int log_p, double *dwork)
+{
+    int i, ord = 0;
+    double y, z = 0.0;
+
+    if (q < 0.0)
+        return ACT_DT_0;
+
+    if (q == 0.0)
+    {
+        for (i = 0; i < T->m; i++)
+            z += pi[i];
+        return ACT_DT_Cval(z);
+    }
+
+    if (!R_FINITE(q))
+        return ACT_DT_1;
+
+    pphtype_bidiag_grid(&q, &ord, 1, pi, T, lower_tail, log_p, &y, dwork);
+    return y;
+}
+
+double mphtype_bidiag(double order, double *pi, phtype_bidiag_struct *T,
+                      int give_log, double *dwork)
+{
+    /* Raw moment is order! * pi * (-T)^(-order) * e, computed with
+     * 'order' solutions of linear systems in -T. */
+
+    if (order < 0.0 || ACT_nonint(order))
+        return R_NaN;
+
+    int i, k, m = T->m;
+    double z = 0.0, *y = dwork, *r = dwork + m, *tmp;
+
+    for (i = 0; i < m; i++)
+        y[i] = 1.0;
+    for (k = 0; k < (int) order; k++)
+    {
+        tmp = r; r = y; y = tmp;
+        bidiag_solve(T, 0.0, r, y, dwork + 2 * m);
+    }
+    for (i = 0; i < m; i++)
+        z += pi[i] * y[i];
+
+    return ACT_D_val(gammafn(order + 1.0) * z);
+}
+
+double mgfphtype_bidiag(double x, double *pi, phtype_bidiag_struct *T,
+                        int give_log, double *dwork)
+{
+    /* Moment generating function is 1 - pi * (e + (x * I + T)^(-1) * t);
+     * see mgfphtype(). */
+
+    if (x == 0.0)
+        return ACT_D_exp(0.0);
+
+    int i, m = T->m;
+    double z = 0.0, *t = dwork, *y = dwork + m;
+
+    /* (x I + T) y = t is (-x I - T) y = -t */
+    bidiag_exit(T, t);
+    for (i = 0; i < m; i++)
+        t[i] = -t[i];
+    bidiag_solve(T, -x, t, y, dwork + 2 * m);
+
+    for (i = 0; i < m; i++)
+        z += pi[i] * (1 + y[i]);
+
+    return ACT_D_Clog(z);
 }
 
 double rphtype(double *pi, double **Q, double *rates, int m)
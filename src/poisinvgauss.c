@@ -63,6 +63,76 @@ double dpoisinvgauss(double x, double mu, double phi, int give_log)
     return give_log ? lpx + log(K) : exp(lpx) * K;
 }
 
+/*  Prepared distribution (see prepare.c). The constants of the
+ *  density above are stored in 'c': c[0] = log(A), c[1] = log(B) and
+ *  c[2] = B/phi, the argument of the Bessel function. The quantile
+ *  function is not prepared since its search relies on
+ *  ppoisinvgauss().
+ */
+int prepare_poisinvgauss(const double *par, double *c)
+{
+    double mu = par[0], phi = par[1];
+
+    if (!(mu > 0.0) || !(phi > 0.0))
+        return 0;
+
+    double phim = phi * mu, lphi = log(phi);
+    double a = 1/(2 * phim * mu);
+
+    c[0] = -lphi/2 - M_LN_SQRT_PId2 + 1/phim;
+    c[1] = (M_LN2 + lphi + log1p(a))/2;
+    c[2] = exp(c[1] - lphi);
+
+    return 1;
+}
+
+double dpoisinvgauss_prep(double x, const double *par, const double *c,
+                          int give_log)
+{
+    ACT_D_nonint_check(x);
+
+    if (!R_FINITE(x) || x < 0.0)
+	return ACT_D__0;
+
+    /* limiting case phi = Inf */
+    if (!R_FINITE(par[1]))
+	return (x == 0) ? ACT_D__1 : ACT_D__0;
+
+    double y = x - 0.5;
+    double lpx = c[0] - y * c[1] - lgamma1p(x);
+    double K = bessel_k(c[2], y, /*expo*/1);
+
+    return give_log ? lpx + log(K) : exp(lpx) * K;
+}
+
+double ppoisinvgauss_prep(double q, const double *par, const double *c,
+                          int lower_tail, int log_p)
+{
+    if (q < 0)
+        return ACT_DT_0;
+
+    /* limiting case phi = Inf */
+    if (!R_FINITE(par[1]) || !R_FINITE(q))
+    	return ACT_DT_1;
+
+    int x;
+    double y, s = 0;
+
+    for (x = 0; x <= q; x++)
+    {
+	y = x - 0.5;
+	s += exp(c[0] - y * c[1] - lgamma1p(x)) * bessel_k(c[2], y, /*expo*/1);
+    }
+
+    return ACT_D_val(s);
+}
+
+double qpoisinvgauss_prep(double p, const double *par, const double *c,
+                          int lower_tail, int log_p)
+{
+    return qpoisinvgauss(p, par[0], par[1], lower_tail, log_p);
+}
+
 /*  For ppoisinvgauss(), there does not seem to be algorithms much
  *  more elaborate that successive computations of the probabilities.
  *  Performance wise, the explicit formula used in dpoisinvgauss() is
@@ -0,0 +1,165 @@
+/*  ===== actuar: An R Package for Actuarial Science =====
+ *
+ *  Prepared ("frozen") distributions. Function actuar_do_prepare()
+ *  validates the parameters of a distribution and returns the
+ *  constants depending on the parameters only. Function
+ *  actuar_do_dpqprep() then evaluates the density, distribution or
+ *  quantile function, or the limited moment, with these constants,
+ *  so that only the calculations depending on the argument are
+ *  carried out for each element.
+ *
+ *  The distributions and their functions are found in table
+ *  prepared_tab of names.c. To add a distribution: write the
+ *  prepare_dist() and {d,p,q,lev}dist_prep() functions alongside the
+ *  usual functions of the distribution, declare them in actuar.h
+ *  and add an entry in the table.
+ *
+ *  AUTHOR: Vincent Goulet <vincent.goulet@act.ulaval.ca>
+ */
+
+#include <R.h>
+#include <Rinternals.h>
+#include "actuar.h"
+#include "locale.h"
+
+/* Additional access macros */
+#define CAD5R(e) CAR(CDR(CDR(CDR(CDR(CDR(e))))))
+#define CAD6R(e) CAR(CDR(CDR(CDR(CDR(CDR(CDR(e)))))))
+
+/* Look up a distribution in the table and check the number of
+ * parameters. */
+static prepared_tab_struct *prepared_lookup(SEXP name, SEXP par)
+{
+    int i;
+    const char *s = CHAR(STRING_ELT(name, 0));
+
+    for (i = 0; prepared_tab[i].name; i++)
+    {
+	if (!strcmp(prepared_tab[i].name, s))
+	{
+	    if (LENGTH(par) != prepared_tab[i].npar)
+		error(_("invalid arguments"));
+	    return &prepared_tab[i];
+	}
+    }
+
+    /* No match is an error */
+    error(_("internal error in actuar_do_prepare"));
+
+    return NULL;		/* never used; to keep -Wall happy */
+}
+
+/*  Arguments of actuar_do_prepare() are the name of the distribution
+ *  (without prefix, e.g. "trbeta") and the vector of its parameters.
+ *  The value is the vector of constants. */
+SEXP actuar_do_prepare(SEXP args)
+{
+    SEXP spar, sc;
+    prepared_tab_struct *dist;
+
+    args = CDR(args);
+    PROTECT(spar = coerceVector(CADR(args), REALSXP));
+    dist = prepared_lookup(CAR(args), spar);
+
+    PROTECT(sc = allocVector(REALSXP, dist->nconst));
+    if (!dist->prepare(REAL(spar), REAL(sc)))
+	error(_("invalid parameters"));
+
+    UNPROTECT(2);
+    return sc;
+}
+
+/*  Arguments of actuar_do_dpqprep() are:
+ *
+ *      1. the name of the distribution;
+ *      2. the function: "d", "p", "q" or "lev";
+ *      3. the value(s) where the function is to be evaluated;
+ *      4. the vector of parameters;
+ *      5. the vector of constants returned by actuar_do_prepare();
+ *      6. whether to return the density in log scale (d) or the
+ *         lower tail probability or quantile (p and q), or the order
+ *         of the limited moment (lev);
+ *      7. whether to return the probability in log scale (p and q
+ *         only).
+ *
+ *  The value is the vector of results with the attributes of the
+ *  third argument. */
+SEXP actuar_do_dpqprep(SEXP args)
+{
+    SEXP sx, spar, sc, sy;
+    prepared_tab_struct *dist;
+    const char *fun;
+    double xi, order, *x, *y, *par, *c, co[PREPARED_MAXCONST];
+    int i, n, i_1 = 0, i_2 = 0, sxo;
+    Rboolean naflag = FALSE;
+
+    args = CDR(args);
+    sx = CADDR(args);
+    if (!isNumeric(sx))
+	error(_("invalid arguments"));
+    PROTECT(spar = coerceVector(CADDDR(args), REALSXP));
+    PROTECT(sc = coerceVector(CAD4R(args), REALSXP));
+    dist = prepared_lookup(CAR(args), spar);
+    if (LENGTH(sc) != dist->nconst)
+	error(_("invalid arguments"));
+    fun = CHAR(STRING_ELT(CADR(args), 0));
+
+    n = LENGTH(sx);
+    sxo = OBJECT(sx);
+    PROTECT(sx = coerceVector(sx, REALSXP));
+    PROTECT(sy = allocVector(REALSXP, n));
+    x = REAL(sx);
+    y = REAL(sy);
+    par = REAL(spar);
+    c = REAL(sc);
+
+#define PREP_ITERATE(EXPR)                      \
+    for (i = 0; i < n; i++)                     \
+    {                                           \
+	xi = x[i];                              \
+	if (ISNA(xi)) y[i] = NA_REAL;           \
+	else if (ISNAN(xi)) y[i] = R_NaN;       \
+	else                                    \
+	{                                       \
+	    y[i] = EXPR;                        \
+	    if (ISNAN(y[i])) naflag = TRUE;     \
+	}                                       \
+    }
+
+    if (!strcmp(fun, "d") && dist->d)
+    {
+	i_1 = asInteger(CAD5R(args));
+	PREP_ITERATE(dist->d(xi, par, c, i_1));
+    }
+    else if (!strcmp(fun, "p") && dist->p)
+    {
+	i_1 = asInteger(CAD5R(args));
+	i_2 = asInteger(CAD6R(args));
+	PREP_ITERATE(dist->p(xi, par, c, i_1, i_2));
+    }
+    else if (!strcmp(fun, "q") && dist->q)
+    {
+	i_1 = asInteger(CAD5R(args));
+	i_2 = asInteger(CAD6R(args));
+	PREP_ITERATE(dist->q(xi, par, c, i_1, i_2));
+    }
+    else if (!strcmp(fun, "lev") && dist->lev)
+    {
+	/* The constants depending on the order are computed once. */
+	order = asReal(CAD5R(args));
+	if (R_FINITE(order))
+	    dist->prepare_lev(order, par, c, co);
+	PREP_ITERATE(dist->lev(xi, order, par, c, co));
+    }
+    else
+	error(_("internal error in actuar_do_dpqprep"));
+
+    if (naflag)
+	warning(R_MSG_NA);
+
+    SET_ATTRIB(sy, duplicate(ATTRIB(sx)));
+    SET_OBJECT(sy, sxo);
+
+    UNPROTECT(4);
+    return sy;
+}
@@ -0,0 +1,292 @@
+/*  ===== actuar: An R Package for Actuarial Science =====
+ *
+ *  Sub-intensity matrix of the ladder height distribution in the
+ *  Sparre Andersen model with phase-type claim amounts (pi, T) and
+ *  phase-type interarrival times (alpha, S). From Asmussen & Rolski
+ *  (1991), the matrix is Q = T + t q, with t = -T e, where the row
+ *  vector q is a fixed point of
+ *
+ *    Phi(q) = pi * int_0^Inf exp(Q y) f(y) dy,  f(y) = alpha exp(S y) s,
+ *
+ *  with s = -S e. Rather than solving the system of order nm
+ *  (Q %x% I + I %x% S) X = I %x% s of the direct formulation, we use
+ *
+ *    Phi(q) = -(Y alpha')',  where  Q' Y + Y S' = pi' s'
+ *
+ *  is a Sylvester equation of size n x m, solved with the real Schur
+ *  decompositions of Q' and S' (LAPACK dgees) and the triangular
+ *  solver dtrsyl. The decomposition of S' is computed once.
+ *
+ *  The equation q = Phi(q) is solved by Newton's method. The column
+ *  l of the Jacobian of Phi is -(dY alpha')' where dY solves the same
+ *  Sylvester equation with right hand side e_l (-t' Y), so it reuses
+ *  the Schur decompositions of the evaluation of Phi. Starting from
+ *  q = 0, as the fixed point iteration, Newton's method converges in
+ *  a few iterations; a plain fixed point step is taken whenever the
+ *  Newton step leaves the nonnegative orthant.
+ *
+ *  See ../R/ruin.R for details.
+ *
+ *  AUTHOR: Vincent Goulet <vincent.goulet@act.ulaval.ca>
+ */
+
+#include <R.h>
+#include <Rinternals.h>
+#include <Rmath.h>
+#include <R_ext/Lapack.h>
+#include <R_ext/BLAS.h>
+#include "actuar.h"
+#include "locale.h"
+
+/* Additional access macros */
+#define CAD5R(e) CAR(CDR(CDR(CDR(CDR(CDR(e))))))
+#define CAD6R(e) CAR(CDR(CDR(CDR(CDR(CDR(CDR(e)))))))
+
+/* Dimensions, fixed quantities and workspaces. Matrices are stored
+ * in column major order. */
+typedef struct {
+    int n, m, lwork;
+    double *T, *pi, *t;		/* claim amounts; t = -T e */
+    double *TS, *V;		/* Schur decomposition S' = V TS V' */
+    double *beta, *gamma;	/* V' alpha' and V' s */
+    double *Q, *U;		/* Q' = U Q U' after ruin_phi() */
+    double *Y, *C;		/* V' Y U, right hand sides */
+    double *a, *b, *wr, *wi, *work;
+    int *bwork;
+} ruin_struct;
+
+/* Real Schur decomposition of the (n x n) matrix A, overwritten by
+ * the quasi-triangular factor, with orthogonal factor in Z. */
+static void ruin_schur(double *A, int n, double *Z, ruin_struct *r)
+{
+    int sdim, info;
+
+    F77_CALL(dgees)("V", "N", NULL, &n, A, &n, &sdim, r->wr, r->wi,
+		    Z, &n, r->work, &r->lwork, r->bwork, &info);
+    if (info)
+	error(_("LAPACK routine dgees returned info code %d"), info);
+}
+
+/* Solution of Q' Y + Y S' = U (x %o% y) V in the Schur bases, that is
+ * the transformed solution U' Y V, in r->C. */
+static void ruin_sylvester(ruin_struct *r, double *x, double *y)
+{
+    int i, j, n = r->n, m = r->m, ione = 1, info;
+    double scale;
+
+    for (j = 0; j < m; j++)
+	for (i = 0; i < n; i++)
+	    r->C[i + j * n] = x[i] * y[j];
+    F77_CALL(dtrsyl)("N", "N", &ione, &n, &m, r->Q, &n, r->TS, &m,
+		     r->C, &n, &scale, &info);
+    if (info < 0)
+	error(_("LAPACK routine dtrsyl returned info code %d"), info);
+    if (scale != 1.0)
+	for (i = 0; i < n * m; i++)
+	    r->C[i] /= scale;
+}
+
+/* Value of -U (C beta), that is -(Y alpha')' in the original basis,
+ * in 'res'. */
+static void ruin_project(ruin_struct *r, double *res)
+{
+    int n = r->n, m = r->m, ione = 1;
+    double one = 1.0, mone = -1.0, zero = 0.0;
+
+    F77_CALL(dgemv)("N", &n, &m, &one, r->C, &n, r->beta, &ione,
+		    &zero, r->a, &ione);
+    F77_CALL(dgemv)("N", &n, &n, &mone, r->U, &n, r->a, &ione,
+		    &zero, res, &ione);
+}
+
+/* Value of Phi(q) in 'phi' and, if 'jac' is not NULL, the Jacobian of
+ * Phi at q, with element (k, l) the derivative of Phi_k with respect
+ * to q_l. */
+static void ruin_phi(ruin_struct *r, double *q, double *phi, double *jac)
+{
+    int i, j, l, n = r->n, m = r->m, ione = 1;
+    double one = 1.0, mone = -1.0, zero = 0.0;
+
+    /* Q' = T' + q' t', decomposed in place. */
+    for (j = 0; j < n; j++)
+	for (i = 0; i < n; i++)
+	    r->Q[i + j * n] = r->T[j + i * n] + q[i] * r->t[j];
+    ruin_schur(r->Q, n, r->U, r);
+
+    /* Right hand side pi' s' is U (U' pi') (V' s)' V. */
+    F77_CALL(dgemv)("T", &n, &n, &one, r->U, &n, r->pi, &ione,
+		    &zero, r->a, &ione);
+    Memcpy(r->b, r->a, n);
+    ruin_sylvester(r, r->b, r->gamma);
+    ruin_project(r, phi);
+
+    if (!jac)
+	return;
+
+    /* Right hand sides e_l (-t' Y) are U (U' e_l) (-t' U C) V. */
+    Memcpy(r->Y, r->C, n * m);
+    F77_CALL(dgemv)("T", &n, &n, &one, r->U, &n, r->t, &ione,
+		    &zero, r->a, &ione);
+    F77_CALL(dgemv)("T", &n, &m, &mone, r->Y, &n, r->a, &ione,
+		    &zero, r->wr, &ione);
+    for (l = 0; l < n; l++)
+    {
+	for (i = 0; i < n; i++)
+	    r->b[i] = r->U[l + i * n];
+	ruin_sylvester(r, r->b, r->wr);
+	ruin_project(r, jac + l * n);
+    }
+}
+
+/* Arguments of .External(): sub-intensity matrix and initial
+ * probabilities of the claim amounts distribution; sub-intensity
+ * matrix and initial probabilities of the interarrival times
+ * distribution; tolerance; maximum number of iterations; whether to
+ * print the iterations. Returns matrix Q. */
+SEXP actuar_do_ruinsa(SEXP args)
+{
+    SEXP sT, spi, sS, salpha, ans;
+    ruin_struct r;
+    int i, j, n, m, k, count, maxit, echo, info, *ipiv;
+    double tol, tmax, crit, *S, *alpha, *q, *phi, *jac, *delta, *s;
+
+    args = CDR(args);
+    PROTECT(sT = coerceVector(CAR(args), REALSXP));
+    PROTECT(spi = coerceVector(CADR(args), REALSXP));
+    PROTECT(sS = coerceVector(CADDR(args), REALSXP));
+    PROTECT(salpha = coerceVector(CADDDR(args), REALSXP));
+    tol = asReal(CAD4R(args));
+    maxit = asInteger(CAD5R(args));
+    echo = asLogical(CAD6R(args)) == TRUE;
+
+    n = LENGTH(spi);
+    m = LENGTH(salpha);
+    if (LENGTH(sT) != n * n || LENGTH(sS) != m * m)
+	error(_("invalid arguments"));
+
+    r.n = n;
+    r.m = m;
+    r.T = REAL(sT);
+    r.pi = REAL(spi);
+    S = REAL(sS);
+    alpha = REAL(salpha);
+
+    k = imax2(n, m);
+    r.lwork = 8 * k;
+    r.t = (double *) R_alloc(n, sizeof(double));
+    r.TS = (double *) R_alloc(m * m, sizeof(double));
+    r.V = (double *) R_alloc(m * m, sizeof(double));
+    r.beta = (double *) R_alloc(m, sizeof(double));
+    r.gamma = (double *) R_alloc(m, sizeof(double));
+    r.Q = (double *) R_alloc(n * n, sizeof(double));
+    r.U = (double *) R_alloc(n * n, sizeof(double));
+    r.Y = (double *) R_alloc(n * m, sizeof(double));
+    r.C = (double *) R_alloc(n * m, sizeof(double));
+    r.a = (double *) R_alloc(n, sizeof(double));
+    r.b = (double *) R_alloc(n, sizeof(double));
+    r.wr = (double *) R_alloc(k, sizeof(double));
+    r.wi = (double *) R_alloc(k, sizeof(double));
+    r.work = (double *) R_alloc(r.lwork, sizeof(double));
+    r.bwork = (int *) R_alloc(k, sizeof(int));
+    s = (double *) R_alloc(m, sizeof(double));
+    q = (double *) R_alloc(n, sizeof(double));
+    phi = (double *) R_alloc(n, sizeof(double));
+    delta = (double *) R_alloc(n, sizeof(double));
+    jac = (double *) R_alloc(n * n, sizeof(double));
+    ipiv = (int *) R_alloc(n, sizeof(int));
+
+    /* Exit rates vectors t = -T e and s = -S e, and Schur
+     * decomposition of S' with the vectors V' alpha' and V' s. */
+    tmax = 0.0;
+    for (i = 0; i < n; i++)
+    {
+	r.t[i] = 0.0;
+	for (j = 0; j < n; j++)
+	    r.t[i] -= r.T[i + j * n];
+	tmax = fmax2(tmax, fabs(r.t[i]));
+    }
+    for (i = 0; i < m; i++)
+    {
+	s[i] = 0.0;
+	for (j = 0; j < m; j++)
+	{
+	    s[i] -= S[i + j * m];
+	    r.TS[i + j * m] = S[j + i * m];
+	}
+    }
+    ruin_schur(r.TS, m, r.V, &r);
+    for (j = 0; j < m; j++)
+    {
+	r.beta[j] = r.gamma[j] = 0.0;
+	for (i = 0; i < m; i++)
+	{
+	    r.beta[j] += r.V[i + j * m] * alpha[i];
+	    r.gamma[j] += r.V[i + j * m] * s[i];
+	}
+    }
+
+    /* Iterations from Q = T, that is q = 0. The stopping criterion is
+     * the one of the fixed point iteration: the maximum absolute row
+     * sum of the difference between Q and the next iterate. */
+    for (i = 0; i < n; i++)
+	q[i] = 0.0;
+    count = 0;
+    if (echo)
+	Rprintf(_("Iteration\tMatrix Q (column major order)\n"));
+    for (;;)
+    {
+	if (echo)
+	{
+	    Rprintf("  %d \t\t ", count);
+	    for (j = 0; j < n; j++)
+		for (i = 0; i < n; i++)
+		    Rprintf(" %.7g", r.T[i + j * n] + r.t[i] * q[j]);
+	    Rprintf("\n");
+	}
+
+	if (maxit < ++count)
+	{
+	    warning(_("maximum number of iterations reached before obtaining convergence"));
+	    break;
+	}
+
+	R_CheckUserInterrupt();
+	ruin_phi(&r, q, phi, jac);
+
+	crit = 0.0;
+	for (i = 0; i < n; i++)
+	{
+	    delta[i] = phi[i] - q[i];
+	    crit += fabs(delta[i]);
+	}
+	if (tmax * crit < tol)
+	{
+	    Memcpy(q, phi, n);
+	    break;
+	}
+
+	/* Newton step: (I - J) delta = Phi(q) - q. */
+	for (i = 0; i < n * n; i++)
+	    jac[i] = -jac[i];
+	for (i = 0; i < n; i++)
+	    jac[i * (n + 1)] += 1.0;
+	j = 1;
+	F77_CALL(dgesv)(&n, &j, jac, &n, ipiv, delta, &n, &info);
+	for (i = 0; i < n && !info; i++)
+	    if (!R_FINITE(q[i] + delta[i]) || q[i] + delta[i] < 0.0)
+		info = 1;
+	if (info)
+	    Memcpy(q, phi, n);	/* fixed point step */
+	else
+	    for (i = 0; i < n; i++)
+		q[i] += delta[i];
+    }
+
+    PROTECT(ans = allocMatrix(REALSXP, n, n));
+    for (j = 0; j < n; j++)
+	for (i = 0; i < n; i++)
+	    REAL(ans)[i + j * n] = r.T[i + j * n] + r.t[i] * q[j];
+
+    UNPROTECT(5);
+    return ans;
+}
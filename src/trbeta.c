@@ -186,3 +186,239 @@ double levtrbeta(double limit, double shape1, double shape2, double shape3,
 	/ (gammafn(shape1) * gammafn(shape3))
 	+ ACT_DLIM__0(limit, order) * pbeta(u, shape3, shape1, 0, 0);
 }
+
+/*  Prepared distribution (see prepare.c). The parameters are
+ *  validated once and the constants depending on them only are
+ *  stored in 'c':
+ *
+ *      c[0] = log(shape2),
+ *      c[1] = log(scale),
+ *      c[2] = lbeta(shape3, shape1),
+ *      c[3] = gammafn(shape1) * gammafn(shape3),
+ *      c[4] = -1/shape2.
+ *
+ *  The constants of the limited moment depending on the order are
+ *  stored in 'co': co[0] = scale^order, co[1] = order/shape2.
+ */
+int prepare_trbeta(const double *par, double *c)
+{
+    double shape1 = par[0], shape2 = par[1], shape3 = par[2], scale = par[3];
+
+    if (!R_FINITE(shape1) ||
+        !R_FINITE(shape2) ||
+        !R_FINITE(shape3) ||
+        !R_FINITE(scale) ||
+        shape1 <= 0.0 ||
+        shape2 <= 0.0 ||
+        shape3 <= 0.0 ||
+        scale <= 0.0)
+        return 0;
+
+    c[0] = log(shape2);
+    c[1] = log(scale);
+    c[2] = lbeta(shape3, shape1);
+    c[3] = gammafn(shape1) * gammafn(shape3);
+    c[4] = -1.0 / shape2;
+
+    return 1;
+}
+
+double dtrbeta_prep(double x, const double *par, const double *c,
+                    int give_log)
+{
+    double shape1 = par[0], shape2 = par[1], shape3 = par[2], scale = par[3];
+
+    if (!R_FINITE(x) || x < 0.0)
+        return ACT_D__0;
+
+    if (x == 0.0)
+    {
+	if (shape2 * shape3 < 1) return R_PosInf;
+	if (shape2 * shape3 > 1) return ACT_D__0;
+	/* else */
+	return give_log ?
+	    c[0] - c[1] - c[2] :
+	    shape2 / (scale * beta(shape3, shape1));
+    }
+
+    double tmp, logu, log1mu;
+
+    tmp = shape2 * (log(x) - c[1]);
+    logu = - log1pexp(-tmp);
+    log1mu = - log1pexp(tmp);
+
+    return ACT_D_exp(c[0] + shape3 * logu + shape1 * log1mu
+                   - log(x) - c[2]);
+}
+
+double ptrbeta_prep(double q, const double *par, const double *c,
+                    int lower_tail, int log_p)
+{
+    if (q <= 0)
+        return ACT_DT_0;
+
+    double u = exp(-log1pexp(-par[1] * (log(q) - c[1])));
+
+    return pbeta(u, par[2], par[0], lower_tail, log_p);
+}
+
+double qtrbeta_prep(double p, const double *par, const double *c,
+                    int lower_tail, int log_p)
+{
+    ACT_Q_P01_boundaries(p, 0, R_PosInf);
+    p = ACT_D_qIv(p);
+
+    return par[3] * R_pow(1.0 / qbeta(p, par[2], par[0], lower_tail, 0) - 1.0,
+                          c[4]);
+}
+
+void prepare_levtrbeta(double order, const double *par, const double *c,
+                       double *co)
+{
+    co[0] = R_pow(par[3], order);
+    co[1] = order / par[1];
+}
+
+double levtrbeta_prep(double limit, double order, const double *par,
+                      const double *c, const double *co)
+{
+    double shape1 = par[0], shape2 = par[1], shape3 = par[2];
+
+    if (!R_FINITE(order))
+        return R_NaN;
+
+    if (order <= - shape3 * shape2)
+        return R_PosInf;
+
+    if (limit <= 0.0)
+        return 0.0;
+
+    double u = exp(-log1pexp(-shape2 * (log(limit) - c[1])));
+
+    return co[0]
+	* betaint_raw(u, shape3 + co[1], shape1 - co[1])
+	/ c[3]
+	+ ACT_DLIM__0(limit, order) * pbeta(u, shape3, shape1, 0, 0);
+}
+
+/*  Gradients for the log-likelihood routines (see loglik.c). The
+ *  functions *_grad() return the log of the density (or of the
+ *  survival function) at 'x' and store in 'grad' its partial
+ *  derivatives with respect to the parameters 'par'; 'grad' is left
+ *  unset when the returned value is not finite.
+ *
+ *  The derivatives for the transformed beta distribution are
+ *  computed in trbeta_dgrad_raw() and trbeta_pgrad_raw() below for
+ *  all the members of the family: the caller maps them to its own
+ *  parameters with the chain rule. With u = v/(1 + v),
+ *  v = (x/scale)^shape2 and a = shape3 - (shape1 + shape3) * u, the
+ *  partial derivatives of the log-density are
+ *
+ *      shape1: log(1 - u) - digamma(shape1) + digamma(shape1 + shape3),
+ *      shape2: 1/shape2 + a * log(x/scale),
+ *      shape3: log(u) - digamma(shape3) + digamma(shape1 + shape3),
+ *      scale:  -a * shape2/scale.
+ *
+ *  When shape1 or shape3 is one, the difference of digamma functions
+ *  is replaced by its exact value. The members of the family with one
+ *  of these parameters fixed to one call trbeta_dgrad_raw() with
+ *  'psi' false to skip the digamma functions in the derivative with
+ *  respect to that parameter, which is then not computed.
+ */
+void trbeta_dgrad_raw(double x, double shape1, double shape2,
+                      double shape3, double scale, int psi, double *grad)
+{
+    double psi1, psi3;
+
+    if (shape1 != 1.0 && shape3 != 1.0)
+    {
+	double psi13 = digamma(shape1 + shape3);
+	psi1 = digamma(shape1) - psi13;
+	psi3 = digamma(shape3) - psi13;
+    }
+    else if (shape3 == 1.0)
+    {
+	psi1 = -1.0 / shape1;
+	psi3 = (shape1 == 1.0) ? -1.0 :
+	    psi ? digamma(1.0) - digamma(shape1 + 1.0) : 0.0;
+    }
+    else
+    {
+	psi1 = psi ? digamma(1.0) - digamma(shape3 + 1.0) : 0.0;
+	psi3 = -1.0 / shape3;
+    }
+
+    /* limit of the density at x == 0 when shape2 * shape3 == 1 */
+    if (x == 0.0)
+    {
+	grad[0] = -psi1;
+	grad[1] = 1.0 / shape2;
+	grad[2] = -psi3;
+	grad[3] = -1.0 / scale;
+	return;
+    }
+
+    double lx, tmp, logu, log1mu, a;
+
+    lx = log(x) - log(scale);
+    tmp = shape2 * lx;
+    logu = - log1pexp(-tmp);
+    log1mu = - log1pexp(tmp);
+    a = shape3 - (shape1 + shape3) * exp(logu);
+
+    grad[0] = log1mu - psi1;
+    grad[1] = 1.0 / shape2 + a * lx;
+    grad[2] = logu - psi3;
+    grad[3] = -a * shape2 / scale;
+}
+
+/*  Partial derivatives of the log of the survival function of the
+ *  members of the family with a survival function in closed form,
+ *  that is with shape3 == 1 [(1 - u)^shape1] or with shape1 == 1
+ *  [1 - u^shape3]. The derivative with respect to shape1 (shape3) is
+ *  set to zero unless shape3 (shape1) is one.
+ */
+void trbeta_pgrad_raw(double x, double shape1, double shape2,
+                      double shape3, double scale, double *grad)
+{
+    double lx, tmp, logu, log1mu, dt = 0.0;
+
+    grad[0] = grad[2] = 0.0;
+
+    /* survival function equal to one */
+    if (x <= 0.0)
+    {
+	grad[1] = grad[3] = 0.0;
+	return;
+    }
+
+    lx = log(x) - log(scale);
+    tmp = shape2 * lx;
+    logu = - log1pexp(-tmp);
+    log1mu = - log1pexp(tmp);
+
+    if (shape1 == 1.0)
+    {
+	double w = shape3 * logu, s = -expm1(w);
+	grad[2] = - exp(w) * logu / s;
+	dt = - shape3 * exp(w + log1mu) / s;
+    }
+    if (shape3 == 1.0)
+    {
+	grad[0] = log1mu;
+	dt = - shape1 * exp(logu);
+    }
+
+    grad[1] = dt * lx;
+    grad[3] = - dt * shape2 / scale;
+}
+
+double dtrbeta_grad(double x, const double *par, double *grad)
+{
+    double lf = dtrbeta(x, par[0], par[1], par[2], par[3], /*give_log*/1);
+
+    if (R_FINITE(lf))
+	trbeta_dgrad_raw(x, par[0], par[1], par[2], par[3], 1, grad);
+
+    return lf;
+}
@@ -168,3 +168,38 @@ double levtrgamma(double limit, double shape1, double shape2, double scale,
         * pgamma(u, tmp, 1.0, 1, 0) / gammafn(shape1)
         + ACT_DLIM__0(limit, order) * pgamma(u, shape1, 1.0, 0, 0);
 }
+
+/*  Gradient for the log-likelihood routines (see loglik.c). With
+ *  u = (x/scale)^shape2, the partial derivatives of the log-density
+ *  are
+ *
+ *      shape1: log(u) - digamma(shape1),
+ *      shape2: 1/shape2 + (shape1 - u) * log(x/scale),
+ *      scale:  -(shape1 - u) * shape2/scale.
+ */
+double dtrgamma_grad(double x, const double *par, double *grad)
+{
+    double shape1 = par[0], shape2 = par[1], scale = par[2];
+    double lf = dtrgamma(x, shape1, shape2, scale, /*give_log*/1);
+
+    if (!R_FINITE(lf))
+	return lf;
+
+    /* limit of the density at x == 0 when shape1 * shape2 == 1 */
+    if (x == 0.0)
+    {
+	grad[0] = -digamma(shape1);
+	grad[1] = 1.0 / shape2;
+	grad[2] = -1.0 / scale;
+	return lf;
+    }
+
+    double lx = log(x) - log(scale), logu = shape2 * lx;
+    double a = shape1 - exp(logu);
+
+    grad[0] = logu - digamma(shape1);
+    grad[1] = 1.0 / shape2 + a * lx;
+    grad[2] = -a * shape2 / scale;
+
+    return lf;
+}
@@ -17,57 +17,87 @@
 #include <R_ext/Lapack.h>
 #include <R_ext/BLAS.h>
 #include "locale.h"
+#include "actuar.h"
 
 
-/* For matrix exponential calculations. Pade constants
- *
- *   n_{pqj} = [(p + q - j)! p!]/[(p + q)! j! (p - j)!]
- *
- * and
- *
- *   d_{pqj} = [(p + q - j)! q!]/[(p + q)! j! (q - j)!]
- *
- * for p = q = 8 and j = 1, ..., 8.
+/* For matrix exponential calculations. Coefficients b_j of the
+ * numerator of the [q/q] Pade approximants to exp(x) for q = 3, 5, 7,
+ * 9 and 13, and the largest 1-norms theta_q for which the approximant
+ * of degree q has a backward error below the unit roundoff. See
+ * Higham, N. J. (2005), "The scaling and squaring method for the
+ * matrix exponential revisited", SIAM J. Matrix Anal. Appl. 26(4),
+ * 1179-1193.
  */
-const static double padec88 [] =
+static const double padec3[] = {120.0, 60.0, 12.0, 1.0};
+static const double padec5[] = {30240.0, 15120.0, 3360.0, 420.0, 30.0, 1.0};
+static const double padec7[] = {17297280.0, 8648640.0, 1995840.0, 277200.0,
+                                 25200.0, 1512.0, 56.0, 1.0};
+static const double padec9[] = {17643225600.0, 8821612800.0, 2075673600.0,
+                                 302702400.0, 30270240.0, 2162160.0,
+                                 110880.0, 3960.0, 90.0, 1.0};
+static const double padec13[] = {64764752532480000.0, 32382376266240000.0,
+                                  7771770303897600.0, 1187353796428800.0,
+                                  129060195264000.0, 10559470521600.0,
+                                  670442572800.0, 33522128640.0,
+                                  1323241920.0, 40840800.0, 960960.0,
+                                  16380.0, 182.0, 1.0};
+static const double *padec[] = {padec3, padec5, padec7, padec9};
+static const int padeq[] = {3, 5, 7, 9};
+static const double padetheta[] = {1.495585217958292e-2, 2.539398330063230e-1,
+                                   9.504178996162932e-1, 2.097847961257068e0};
+#define PADETHETA13 5.371920351148152e0
+
+/* a := a + alpha * b for (n x n) matrices */
+static void matadd(double *a, double alpha, double *b, int nsqr)
 {
-    5.0000000000000000e-1,
-    1.1666666666666667e-1,
-    1.6666666666666667e-2,
-    1.6025641025641026e-3,
-    1.0683760683760684e-4,
-    4.8562548562548563e-6,
-    1.3875013875013875e-7,
-    1.9270852604185938e-9,
-};
+    int i;
+    for (i = 0; i < nsqr; i++)
+        a[i] += alpha * b[i];
+}
 
 
 /* Matrix exponential exp(x), where x is an (n x n) matrix. Result z
  * is an (n x n) matrix. Mostly lifted from the core of fonction
  * expm() of package Matrix, which is itself based on the function of
  * the same name in Octave.
+ *
+ * The degree of the Pade approximant (3, 5, 7, 9 or 13) and the
+ * number of squarings are chosen from the 1-norm of the balanced
+ * matrix as in Higham (2005), so that small matrices need only a few
+ * matrix products.
+ *
+ * Function actuar_expm_work() does the calculations in workspaces
+ * 'dwork' of EXPM_DWORK(n) doubles and 'iwork' of EXPM_IWORK(n)
+ * integers provided by the caller, without any call to the R API: it
+ * may be used in threads. The value is 0 on success, otherwise the
+ * number of the LAPACK call that failed, with its code in 'info'.
  */
-void actuar_expm(double *x, int n, double *z)
+int actuar_expm_work(double *x, int n, double *z, double *dwork,
+                     int *iwork, int *info)
 {
     if (n == 1)
         z[0] = exp(x[0]);               /* scalar exponential */
     else
     {
         /* Constants */
-        int i, j;
+        int i, j, k, q;
         int nsqr = n * n, np1 = n + 1, is_uppertri = TRUE;
-        int iloperm, ihiperm, iloscal, ihiscal, info, sqrpowscal;
-        double infnorm, trshift, one = 1.0, zero = 0.0, m1pj = -1;
+        int iloperm, ihiperm, iloscal, ihiscal, sqrpowscal;
+        double norm1, trshift, one = 1.0, zero = 0.0;
+        const double *b;
 
         /* Arrays */
-        int *pivot    = (int *) R_alloc(n, sizeof(int)); /* pivot vector */
-        int *invperm  = (int *) R_alloc(n, sizeof(int)); /* inverse permutation vector */
-        double *perm  = (double *) R_alloc(n, sizeof(double)); /* permutation array */
-        double *scale = (double *) R_alloc(n, sizeof(double)); /* scale array */
-        double *work  = (double *) R_alloc(nsqr, sizeof(double)); /* workspace array */
-        double *npp   = (double *) R_alloc(nsqr, sizeof(double)); /* num. power Pade */
-        double *dpp   = (double *) R_alloc(nsqr, sizeof(double)); /* denom. power Pade */
-        R_CheckStack();
+        int *pivot    = iwork;          /* pivot vector */
+        int *invperm  = iwork + n;      /* inverse permutation vector */
+        double *perm  = dwork;          /* permutation array */
+        double *scale = dwork + n;      /* scale array */
+        double *work  = dwork + 2 * n;  /* workspace array */
+        double *A2    = work + nsqr;    /* x^2 */
+        double *A4    = A2 + nsqr;      /* x^4 */
+        double *A6    = A4 + nsqr;      /* x^6 */
+        double *U     = A6 + nsqr;      /* odd part of the numerator */
+        double *V     = U + nsqr;       /* even part of the numerator */
+        double *tmp;
 
         Memcpy(z, x, nsqr);
 
@@ -97,65 +127,105 @@ void actuar_expm(double *x, int n, double *z)
         }
         else
         {
-            F77_CALL(dgebal)("P", &n, z, &n, &iloperm, &ihiperm, perm, &info);
-            if (info)
-                error(_("LAPACK routine dgebal returned info code %d when permuting"), info);
+            F77_CALL(dgebal)("P", &n, z, &n, &iloperm, &ihiperm, perm, info);
+            if (*info)
+                return 1;
         }
-        F77_CALL(dgebal)("S", &n, z, &n, &iloscal, &ihiscal, scale, &info);
-        if (info)
-            error(_("LAPACK routine dgebal returned info code %d when scaling"), info);
-
-        /* Step 3 of preconditioning: Scaling according to infinity
-         * norm (a priori always needed). */
-        infnorm = F77_CALL(dlange)("I", &n, &n, z, &n, work);
-        sqrpowscal = (infnorm > 0) ? imax2((int) 1 + log(infnorm)/M_LN2, 0) : 0;
-        if (sqrpowscal > 0)
+        F77_CALL(dgebal)("S", &n, z, &n, &iloscal, &ihiscal, scale, info);
+        if (*info)
+            return 2;
+
+        /* Step 3 of preconditioning: choice of the degree of the
+         * Pade approximant from the 1-norm, with scaling only when
+         * the norm exceeds the bound of the approximant of degree
+         * 13. */
+        norm1 = F77_CALL(dlange)("1", &n, &n, z, &n, work);
+        for (k = 0; k < 4 && norm1 > padetheta[k]; k++)
+            ;
+        sqrpowscal = 0;
+        if (k == 4 && norm1 > PADETHETA13)
         {
+            sqrpowscal = (int) ceil(log(norm1 / PADETHETA13) / M_LN2);
             double scalefactor = R_pow_di(2, sqrpowscal);
             for (i = 0; i < nsqr; i++)
                 z[i] /= scalefactor;
         }
 
-        /* Pade approximation (p = q = 8): compute x^8, x^7, x^6,
-         * ..., x^1 */
-        for (i = 0; i < nsqr; i++)
+        /* Pade approximant N(z)/N(-z), with N(z) = U + V where U
+         * holds the odd powers of z and V the even ones. */
+        F77_CALL(dgemm)("N", "N", &n, &n, &n, &one, z, &n, z, &n,
+                        &zero, A2, &n);
+        if (k < 4)
         {
-            npp[i] = 0.0;
-            dpp[i] = 0.0;
+            /* Degree q = 3, 5, 7 or 9: U = z * sum b_{2j+1} z^{2j}
+             * and V = sum b_{2j} z^{2j} accumulated with the powers
+             * of z^2 in A4 (current) and A6 (scratch). */
+            b = padec[k];
+            q = padeq[k];
+            for (i = 0; i < nsqr; i++)
+            {
+                U[i] = b[3] * A2[i];
+                V[i] = b[2] * A2[i];
+            }
+            Memcpy(A4, A2, nsqr);
+            for (j = 2; 2 * j < q; j++)
+            {
+                F77_CALL(dgemm)("N", "N", &n, &n, &n, &one, A4, &n, A2, &n,
+                                &zero, A6, &n);
+                tmp = A4; A4 = A6; A6 = tmp;
+                matadd(U, b[2 * j + 1], A4, nsqr);
+                matadd(V, b[2 * j], A4, nsqr);
+            }
+            for (j = 0; j < n; j++)
+            {
+                U[j * np1] += b[1];
+                V[j * np1] += b[0];
+            }
         }
-        for (j = 7; j >= 0; j--)
+        else
         {
-            /* npp = z * npp + padec88[j] * z */
-            F77_CALL(dgemm) ("N", "N", &n, &n, &n, &one, z, &n, npp,
-                             &n, &zero, work, &n);
-            /* npp <- work + padec88[j] * z */
+            /* Degree 13 with the powers z^2, z^4 and z^6 only. */
+            b = padec13;
+            F77_CALL(dgemm)("N", "N", &n, &n, &n, &one, A2, &n, A2, &n,
+                            &zero, A4, &n);
+            F77_CALL(dgemm)("N", "N", &n, &n, &n, &one, A4, &n, A2, &n,
+                            &zero, A6, &n);
             for (i = 0; i < nsqr; i++)
-                npp[i] = work[i] + padec88[j] * z[i];
-            /* dpp = z * dpp + (-1)^j * padec88[j] * z */
-            F77_CALL(dgemm) ("N", "N", &n, &n, &n, &one, z, &n, dpp,
-                             &n, &zero, work, &n);
+                work[i] = b[13] * A6[i] + b[11] * A4[i] + b[9] * A2[i];
+            F77_CALL(dgemm)("N", "N", &n, &n, &n, &one, A6, &n, work, &n,
+                            &zero, U, &n);
             for (i = 0; i < nsqr; i++)
-                dpp[i] = work[i] + m1pj * padec88[j] * z[i];
-            m1pj *= -1;         /* (-1)^j */
+                work[i] = b[12] * A6[i] + b[10] * A4[i] + b[8] * A2[i];
+            F77_CALL(dgemm)("N", "N", &n, &n, &n, &one, A6, &n, work, &n,
+                            &zero, V, &n);
+            for (i = 0; i < nsqr; i++)
+            {
+                U[i] += b[7] * A6[i] + b[5] * A4[i] + b[3] * A2[i];
+                V[i] += b[6] * A6[i] + b[4] * A4[i] + b[2] * A2[i];
+            }
+            for (j = 0; j < n; j++)
+            {
+                U[j * np1] += b[1];
+                V[j * np1] += b[0];
+            }
         }
-        /* power 0 */
+        F77_CALL(dgemm)("N", "N", &n, &n, &n, &one, z, &n, U, &n,
+                        &zero, work, &n);
+
+        /* Pade approximation is (V - U)^-1 * (V + U). */
         for (i = 0; i < nsqr; i++)
-            dpp[i] *= -1.0;
-        for (j = 0; j < n; j++)
         {
-            npp[j * np1] += 1.0;
-            dpp[j * np1] += 1.0;
+            U[i] = V[i] + work[i];
+            V[i] -= work[i];
         }
+        F77_CALL(dgetrf) (&n, &n, V, &n, pivot, info);
+        if (*info)
+            return 3;
+        F77_CALL(dgetrs) ("N", &n, &n, V, &n, pivot, U, &n, info);
+        if (*info)
+            return 4;
 
-        /* Pade approximation is (dpp)^-1 * npp. */
-        F77_CALL(dgetrf) (&n, &n, dpp, &n, pivot, &info);
-        if (info)
-            error(_("LAPACK routine dgetrf returned info code %d"), info);
-        F77_CALL(dgetrs) ("N", &n, &n, dpp, &n, pivot, npp, &n, &info);
-        if (info)
-            error(_("LAPACK routine dgetrs returned info code %d"), info);
-
-        Memcpy(z, npp, nsqr);
+        Memcpy(z, U, nsqr);
 
         /* Now undo all of the preconditioning */
         /* Preconditioning 3: square the result for every power of 2 */
@@ -215,13 +285,61 @@ void actuar_expm(double *x, int n, double *z)
                 z[i] *= mult;
         }
     }
+
+    return 0;
+}
+
+void actuar_expm(double *x, int n, double *z)
+{
+    int info,
+        *iwork = (int *) R_alloc(EXPM_IWORK(n), sizeof(int));
+    double *dwork = (double *) R_alloc(EXPM_DWORK(n), sizeof(double));
+
+    switch (actuar_expm_work(x, n, z, dwork, iwork, &info))
+    {
+    case 1:
+        error(_("LAPACK routine dgebal returned info code %d when permuting"), info);
+    case 2:
+        error(_("LAPACK routine dgebal returned info code %d when scaling"), info);
+    case 3:
+        error(_("LAPACK routine dgetrf returned info code %d"), info);
+    case 4:
+        error(_("LAPACK routine dgetrs returned info code %d"), info);
+    }
 }
 
 
 
 /* Product x * exp(M) * y, where x is an (1 x n) vector, M is an (n x
  * n) matrix and y is an (n x 1) vector. Result z is a scalar.
+ *
+ * Function actuar_expmprod_work() uses workspaces of
+ * EXPMPROD_DWORK(n) doubles and EXPM_IWORK(n) integers, as
+ * actuar_expm_work() above. The value is NaN if the calculation of
+ * the matrix exponential failed.
  */
+double actuar_expmprod_work(double *x, double *M, double *y, int n,
+                            double *dwork, int *iwork)
+{
+    char *transa = "N";
+    int p = 1, info;
+    double one = 1.0, zero = 0.0;
+    double *tmp = dwork, *expM = dwork + n;
+
+    /* Compute exp(M) */
+    if (actuar_expm_work(M, n, expM, expM + n * n, iwork, &info))
+        return R_NaN;
+
+    /* Product      tmp   := x     * exp(M)
+     * (Dimensions: 1 x n    1 x n   n x n) */
+    F77_CALL(dgemm)(transa, transa, &p, &n, &n, &one,
+                    x, &p, expM, &n, &zero, tmp, &p);
+
+    /* Product      z     := tmp   * y
+     * (Dimensions: 1 x 1    1 x n   n x 1) */
+    return F77_CALL(ddot)(&n, tmp, &p, y, &p);
+}
+
 double actuar_expmprod(double *x, double *M, double *y, int n)
 {
     char *transa = "N";
@@ -246,6 +364,104 @@ double actuar_expmprod(double *x, double *M, double *y, int n)
 
 
 
+/* Action of the matrix exponential z = x * exp(M), where x is an (1
+ * x n) vector and M is an (n x n) matrix with nonnegative
+ * off-diagonal elements and nonpositive row sums, as the
+ * sub-intensity matrices of phase-type distributions. Result z is an
+ * (1 x n) vector.
+ *
+ * The product is computed by uniformization: with lambda the largest
+ * absolute value of the diagonal of M and P = I + M/lambda a
+ * substochastic matrix,
+ *
+ *   x * exp(M) = sum_k exp(-lambda) lambda^k/k! * x * P^k.
+ *
+ * All terms have the sign of x, so there is no cancellation. The
+ * exponential is split in steps of parameter at most EXPMV_STEP to
+ * avoid underflow of the Poisson probabilities. Within each step the
+ * series is truncated when the bound on its remainder falls below
+ * DBL_EPSILON times the sum, which is possible since the 1-norm of x
+ * * P^k does not increase with k. The cost is one vector-matrix
+ * product per term, about lambda + O(sqrt(lambda)) in total, and no
+ * matrix is formed.
+ *
+ * Function actuar_expmv_op_work() takes the matrix M as an operator:
+ * 'vecmat' computes w := w + alpha * u * M for the matrix pointed to
+ * by 'M', whatever its storage, and 'lambda' is the largest absolute
+ * value of its diagonal. Function actuar_expmv_work() is the version
+ * for dense matrices. Both use a workspace of EXPMV_DWORK(n) doubles
+ * and do not call the R API.
+ */
+static void dense_vecmat(double *u, void *M, int n, double alpha,
+                         double *w)
+{
+    int ione = 1;
+    double one = 1.0;
+
+    F77_CALL(dgemv)("T", &n, &n, &alpha, (double *) M, &n, u, &ione,
+                    &one, w, &ione);
+}
+
+void actuar_expmv_work(double *x, double *M, int n, double *z,
+                       double *dwork)
+{
+    int i;
+    double lambda = 0.0;
+
+    for (i = 0; i < n; i++)
+        lambda = fmax2(lambda, -M[i + i * n]);
+
+    actuar_expmv_op_work(x, lambda, dense_vecmat, M, n, z, dwork);
+}
+
+void actuar_expmv_op_work(double *x, double lambda,
+                          void (*vecmat)(double *, void *, int, double, double *),
+                          void *M, int n, double *z, double *dwork)
+{
+    int i, j, k, nsteps, ione = 1;
+    double h, wk, tail, ilambda;
+    double *u = dwork, *w = dwork + n, *tmp;
+
+    Memcpy(z, x, n);
+    if (lambda == 0.0)          /* M is the null matrix */
+        return;
+    ilambda = 1.0/lambda;
+
+    nsteps = (int) ceil(lambda / EXPMV_STEP);
+    h = lambda / nsteps;
+
+    for (j = 0; j < nsteps; j++)
+    {
+        /* Term k = 0 */
+        Memcpy(u, z, n);
+        wk = exp(-h);
+        for (i = 0; i < n; i++)
+            z[i] = wk * u[i];
+
+        for (k = 1; ; k++)
+        {
+            /* u := u * P = u + (u * M)/lambda */
+            Memcpy(w, u, n);
+            vecmat(u, M, n, ilambda, w);
+            tmp = u; u = w; w = tmp;
+
+            wk *= h/k;
+            F77_CALL(daxpy)(&n, &wk, u, &ione, z, &ione);
+
+            /* Bound on the sum of the Poisson probabilities beyond k
+             * times the norm of the current term. */
+            if (k + 2 > h)
+            {
+                tail = wk * h/(k + 1) / (1.0 - h/(k + 2));
+                if (tail * F77_CALL(dasum)(&n, u, &ione) <=
+                    DBL_EPSILON * F77_CALL(dasum)(&n, z, &ione))
+                    break;
+            }
+        }
+    }
+}
+
+
 /* Solution of a real system of linear equations AX = B, where A is an
  * (n x n) matrix and B is an (n x p) matrix. Essentially a simple
  * interface to the LAPACK routine DGESV based on modLa_dgesv() in
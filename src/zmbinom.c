@@ -172,3 +172,77 @@ double rzmbinom(double size, double prob, double p0m)
     	return qbinom(runif((p0 - p0m)/(1 - p0m), 1), size, prob, 1, 0);
     }
 }
+
+/*  Gradients for the log-likelihood routines (see loglik.c). The
+ *  parameter 'size' is an integer held fixed: its derivative is set
+ *  to zero. For x > 0, the derivative of the log of the probability
+ *  function with respect to 'prob' is
+ *
+ *      x/prob - (size - x)/(1 - prob) - size (1 - prob)^(size - 1)/(1 - p0)
+ *
+ *  with limit -(size - 1)/2 at prob = 0. The derivative of the
+ *  survival function of the binomial with respect to 'prob' is
+ *  size * dbinom(x, size - 1, prob).
+ */
+static double zmbinom_dp0(double size, double prob)
+{
+    double lp0 = dbinom_raw(0, size, prob, 1 - prob, /*give_log*/1);
+
+    return size * exp(lp0 - log1p(-prob)) / (-expm1(lp0));
+}
+
+double dzmbinom_grad(double x, const double *par, double *grad)
+{
+    double size = par[0], prob = par[1], p0m = par[2];
+    double lf = dzmbinom(x, size, prob, p0m, /*give_log*/1);
+
+    if (!R_FINITE(lf))
+	return lf;
+
+    grad[0] = 0.0;
+
+    if (x == 0)
+    {
+	grad[1] = 0.0;
+	grad[2] = 1.0 / p0m;
+	return lf;
+    }
+
+    if (size == 1 || prob == 0)
+	grad[1] = -(size - 1)/2;
+    else if (prob == 1)
+	grad[1] = x;
+    else
+	grad[1] = x/prob - (size - x)/(1 - prob) - zmbinom_dp0(size, prob);
+    grad[2] = -1.0 / (1.0 - p0m);
+
+    return lf;
+}
+
+double pzmbinom_grad(double q, const double *par, double *grad)
+{
+    double size = par[0], prob = par[1], p0m = par[2];
+    double ls = pzmbinom(q, size, prob, p0m, /*lower_tail*/0, /*log_p*/1);
+
+    if (!R_FINITE(ls))
+	return ls;
+
+    grad[0] = grad[1] = 0.0;
+    if (q < 0)
+    {
+	grad[2] = 0.0;
+	return ls;
+    }
+
+    grad[2] = -1.0 / (1.0 - p0m);
+    if (q < 1)
+	return ls;
+
+    /* NOTE: from now on 1 <= q < size and 0 < prob < 1 */
+    q = floor(q + 1e-7);
+    grad[1] = size * exp(dbinom(q, size - 1, prob, /*give_log*/1)
+			 - pbinom(q, size, prob, /*l._t.*/0, /*log_p*/1))
+	- zmbinom_dp0(size, prob);
+
+    return ls;
+}
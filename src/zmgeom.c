@@ -125,3 +125,45 @@ double rzmgeom(double prob, double p0m)
 
     return qgeom(runif((prob - p0m)/(1 - p0m), 1), prob, 1, 0);
 }
+
+/*  Gradients for the log-likelihood routines (see loglik.c). For
+ *  x > 0, the probability function is (1 - p0m) prob (1 - prob)^(x - 1)
+ *  and the survival function is (1 - p0m) (1 - prob)^k, with k the
+ *  integer part of x.
+ */
+double dzmgeom_grad(double x, const double *par, double *grad)
+{
+    double prob = par[0], p0m = par[1];
+    double lf = dzmgeom(x, prob, p0m, /*give_log*/1);
+
+    if (!R_FINITE(lf))
+	return lf;
+
+    if (x == 0)
+    {
+	grad[0] = 0.0;
+	grad[1] = 1.0 / p0m;
+	return lf;
+    }
+
+    grad[0] = (x == 1) ? 1.0/prob : 1.0/prob - (x - 1)/(1 - prob);
+    grad[1] = -1.0 / (1.0 - p0m);
+
+    return lf;
+}
+
+double pzmgeom_grad(double q, const double *par, double *grad)
+{
+    double prob = par[0], p0m = par[1];
+    double ls = pzmgeom(q, prob, p0m, /*lower_tail*/0, /*log_p*/1);
+
+    if (!R_FINITE(ls))
+	return ls;
+
+    grad[0] = 0.0;
+    grad[1] = (q < 0) ? 0.0 : -1.0 / (1.0 - p0m);
+    if (q >= 1)
+	grad[0] = -floor(q + 1e-7) / (1 - prob);
+
+    return ls;
+}
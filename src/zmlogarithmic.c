@@ -124,3 +124,25 @@ double rzmlogarithmic(double p, double p0m)
 
     return (unif_rand() < p0m) ? 0.0 : rlogarithmic(p);
 }
+
+/*  Gradient for the log-likelihood routines (see logarithmic.c). */
+double dzmlogarithmic_grad(double x, const double *par, double *grad)
+{
+    double p = par[0], p0m = par[1];
+    double lf = dzmlogarithmic(x, p, p0m, /*give_log*/1);
+
+    if (!R_FINITE(lf))
+	return lf;
+
+    if (x == 0)
+    {
+	grad[0] = 0.0;
+	grad[1] = 1.0 / p0m;
+	return lf;
+    }
+
+    grad[0] = (p == 0) ? -0.5 : x/p + 1.0/((1 - p) * log1p(-p));
+    grad[1] = -1.0 / (1.0 - p0m);
+
+    return lf;
+}
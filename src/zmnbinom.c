@@ -189,3 +189,56 @@ double rzmnbinom(double size, double prob, double p0m)
     	return qnbinom(runif((p0 - p0m)/(1 - p0m), 1), size, prob, 1, 0);
     }
 }
+
+/*  Gradient for the log-likelihood routines (see loglik.c). For
+ *  x > 0, the partial derivatives of the log of the probability
+ *  function are, with p0 = prob^size,
+ *
+ *      size: digamma(x + size) - digamma(size) + log(prob)
+ *              + p0 log(prob)/(1 - p0),
+ *      prob: size/prob - x/(1 - prob) + size p0/(prob (1 - p0)).
+ *
+ *  In the limiting case size = 0 (zero-modified logarithmic), the
+ *  derivative with respect to 'size' is set to zero.
+ */
+double dzmnbinom_grad(double x, const double *par, double *grad)
+{
+    double size = par[0], prob = par[1], p0m = par[2];
+    double lf = dzmnbinom(x, size, prob, p0m, /*give_log*/1);
+
+    if (!R_FINITE(lf))
+	return lf;
+
+    if (x == 0)
+    {
+	grad[0] = grad[1] = 0.0;
+	grad[2] = 1.0 / p0m;
+	return lf;
+    }
+
+    grad[2] = -1.0 / (1.0 - p0m);
+
+    if (size == 0)
+    {
+	double g[2], p[2] = {1 - prob, p0m};
+	dzmlogarithmic_grad(x, p, g);
+	grad[0] = 0.0;
+	grad[1] = -g[0];
+	return lf;
+    }
+
+    /* limiting case prob = 1: mass at one */
+    if (prob == 1)
+    {
+	grad[0] = grad[1] = 0.0;
+	return lf;
+    }
+
+    double lprob = log(prob), lp0 = size * lprob;
+    double r = exp(lp0) / (-expm1(lp0));
+
+    grad[0] = digamma(x + size) - digamma(size) + lprob * (1.0 + r);
+    grad[1] = size * (1.0 + r) / prob - x / (1 - prob);
+
+    return lf;
+}
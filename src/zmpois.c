@@ -165,3 +165,61 @@ double rzmpois(double lambda, double p0m)
 	return qpois(runif((p0 - p0m)/(1 - p0m), 1), lambda, 1, 0);
     }
 }
+
+/*  Gradients for the log-likelihood routines (see loglik.c). For
+ *  x > 0, the derivative of the log of the probability function with
+ *  respect to lambda is x/lambda - 1 - 1/(exp(lambda) - 1), with limit
+ *  -1/2 at lambda = 0. The derivative of the survival function of the
+ *  Poisson with respect to lambda is the probability function at the
+ *  integer part of x.
+ */
+double dzmpois_grad(double x, const double *par, double *grad)
+{
+    double lambda = par[0], p0m = par[1];
+    double lf = dzmpois(x, lambda, p0m, /*give_log*/1);
+
+    if (!R_FINITE(lf))
+	return lf;
+
+    if (x == 0)
+    {
+	grad[0] = 0.0;
+	grad[1] = 1.0 / p0m;
+	return lf;
+    }
+
+    grad[0] = (lambda == 0) ? -0.5 : x/lambda - 1.0 - 1.0/expm1(lambda);
+    grad[1] = -1.0 / (1.0 - p0m);
+
+    return lf;
+}
+
+double pzmpois_grad(double q, const double *par, double *grad)
+{
+    double lambda = par[0], p0m = par[1];
+    double ls = pzmpois(q, lambda, p0m, /*lower_tail*/0, /*log_p*/1);
+
+    if (!R_FINITE(ls))
+	return ls;
+
+    if (q < 0)
+    {
+	grad[0] = grad[1] = 0.0;
+	return ls;
+    }
+
+    grad[1] = -1.0 / (1.0 - p0m);
+    if (q < 1)
+    {
+	grad[0] = 0.0;
+	return ls;
+    }
+
+    /* NOTE: from now on q >= 1 and lambda > 0 */
+    q = floor(q + 1e-7);
+    grad[0] = exp(dpois(q, lambda, /*give_log*/1)
+		  - ppois(q, lambda, /*l._t.*/0, /*log_p*/1))
+	- 1.0/expm1(lambda);
+
+    return ls;
+}
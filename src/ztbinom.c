@@ -125,3 +125,51 @@ double rztbinom(double size, double prob)
 
     return qbinom(runif(p0, 1), size, prob, /*l._t.*/1, /*log_p*/0);
 }
+
+/*  Gradients for the log-likelihood routines (see zmbinom.c). */
+static double ztbinom_dp0(double size, double prob)
+{
+    double lp0 = dbinom_raw(0, size, prob, 1 - prob, /*give_log*/1);
+
+    return size * exp(lp0 - log1p(-prob)) / (-expm1(lp0));
+}
+
+double dztbinom_grad(double x, const double *par, double *grad)
+{
+    double size = par[0], prob = par[1];
+    double lf = dztbinom(x, size, prob, /*give_log*/1);
+
+    if (!R_FINITE(lf))
+	return lf;
+
+    grad[0] = 0.0;
+    if (size == 1 || prob == 0)
+	grad[1] = -(size - 1)/2;
+    else if (prob == 1)
+	grad[1] = x;
+    else
+	grad[1] = x/prob - (size - x)/(1 - prob) - ztbinom_dp0(size, prob);
+
+    return lf;
+}
+
+double pztbinom_grad(double q, const double *par, double *grad)
+{
+    double size = par[0], prob = par[1];
+    double ls = pztbinom(q, size, prob, /*lower_tail*/0, /*log_p*/1);
+
+    if (!R_FINITE(ls))
+	return ls;
+
+    grad[0] = grad[1] = 0.0;
+    if (q < 1)
+	return ls;
+
+    /* NOTE: from now on 1 <= q < size and 0 < prob < 1 */
+    q = floor(q + 1e-7);
+    grad[1] = size * exp(dbinom(q, size - 1, prob, /*give_log*/1)
+			 - pbinom(q, size, prob, /*l._t.*/0, /*log_p*/1))
+	- ztbinom_dp0(size, prob);
+
+    return ls;
+}
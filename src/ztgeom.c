@@ -106,3 +106,26 @@ double rztgeom(double prob)
 
     return 1 + rpois(exp_rand() * ((1 - prob) / prob));
 }
+
+/*  Gradients for the log-likelihood routines (see zmgeom.c). */
+double dztgeom_grad(double x, const double *par, double *grad)
+{
+    double prob = par[0];
+    double lf = dztgeom(x, prob, /*give_log*/1);
+
+    if (R_FINITE(lf))
+	grad[0] = (x == 1) ? 1.0/prob : 1.0/prob - (x - 1)/(1 - prob);
+
+    return lf;
+}
+
+double pztgeom_grad(double q, const double *par, double *grad)
+{
+    double prob = par[0];
+    double ls = pztgeom(q, prob, /*lower_tail*/0, /*log_p*/1);
+
+    if (R_FINITE(ls))
+	grad[0] = (q < 1) ? 0.0 : -floor(q + 1e-7) / (1 - prob);
+
+    return ls;
+}
@@ -138,3 +138,37 @@ double rztnbinom(double size, double prob)
 
     return qnbinom(runif(p0, 1), size, prob, /*l._t.*/1, /*log_p*/0);
 }
+
+/*  Gradient for the log-likelihood routines (see zmnbinom.c). */
+double dztnbinom_grad(double x, const double *par, double *grad)
+{
+    double size = par[0], prob = par[1];
+    double lf = dztnbinom(x, size, prob, /*give_log*/1);
+
+    if (!R_FINITE(lf))
+	return lf;
+
+    if (size == 0)
+    {
+	double p = 1 - prob;
+	dlogarithmic_grad(x, &p, grad + 1);
+	grad[0] = 0.0;
+	grad[1] = -grad[1];
+	return lf;
+    }
+
+    /* limiting case prob = 1: point mass at one */
+    if (prob == 1)
+    {
+	grad[0] = grad[1] = 0.0;
+	return lf;
+    }
+
+    double lprob = log(prob), lp0 = size * lprob;
+    double r = exp(lp0) / (-expm1(lp0));
+
+    grad[0] = digamma(x + size) - digamma(size) + lprob * (1.0 + r);
+    grad[1] = size * (1.0 + r) / prob - x / (1 - prob);
+
+    return lf;
+}
@@ -108,3 +108,38 @@ double rztpois(double lambda)
 
     return qpois(runif(exp(-lambda), 1), lambda, 1, 0);
 }
+
+/*  Gradients for the log-likelihood routines (see zmpois.c). */
+double dztpois_grad(double x, const double *par, double *grad)
+{
+    double lambda = par[0];
+    double lf = dztpois(x, lambda, /*give_log*/1);
+
+    if (R_FINITE(lf))
+	grad[0] = (lambda == 0) ? -0.5 : x/lambda - 1.0 - 1.0/expm1(lambda);
+
+    return lf;
+}
+
+double pztpois_grad(double q, const double *par, double *grad)
+{
+    double lambda = par[0];
+    double ls = pztpois(q, lambda, /*lower_tail*/0, /*log_p*/1);
+
+    if (!R_FINITE(ls))
+	return ls;
+
+    if (q < 1)
+    {
+	grad[0] = 0.0;
+	return ls;
+    }
+
+    /* NOTE: from now on q >= 1 and lambda > 0 */
+    q = floor(q + 1e-7);
+    grad[0] = exp(dpois(q, lambda, /*give_log*/1)
+		  - ppois(q, lambda, /*l._t.*/0, /*log_p*/1))
+	- 1.0/expm1(lambda);
+
+    return ls;
+}